@@ -0,0 +1,75 @@
+// Board backend comparison: the same workloads over every backend.
+//
+//   backend_bench [--max-nodes N] [--bench-depth D]
+//
+// Workloads: perft over the suite positions up to N leaves each (default
+// 2000000), and the engine's `bench` search to depth D (default BENCH_DEPTH)
+// with the searcher and evaluation instantiated on the backend. Prints nodes,
+// seconds and Mnps per backend and workload; exits non-zero if any backend's
+// node count differs from the bitboard backend's.
+//
+// Backends differ in piece storage, attack detection, path tests and piece
+// iteration; the rules code above them, and the geometry tables it reads for
+// piece movement, are shared.
+#include "chess_perft.h"
+#include "chess_bench.h"
+
+#include <iomanip>
+#include <sstream>
+
+struct BackendResult {
+    string name;
+    PerftRun suite, bench;
+};
+
+template<class Board>
+static BackendResult runBackend(uint64_t maxNodes,int benchDepth) {
+    BasicChessGame<Board> game;
+    BackendResult r{Board::name(),{0,0},{0,0}};
+    for (const PerftCase& c:PERFT_CASES) {
+        if (c.nodes>maxNodes) continue;
+        game.loadFen(c.fen);
+        PerftRun p=timePerft(game,c.depth);
+        r.suite.nodes+=p.nodes;
+        r.suite.seconds+=p.seconds;
+    }
+    ostringstream log;
+    BenchResult b=runBench<Board>(benchDepth,log);
+    r.bench={b.nodes,b.elapsed/1000.0};
+    return r;
+}
+
+static void printRun(const char* workload,const PerftRun& p) {
+    cout<<"  "<<left<<setw(8)<<workload<<right<<setw(12)<<p.nodes<<fixed<<setprecision(2)
+        <<setw(8)<<p.seconds<<" s"<<setw(8)<<(p.seconds>0?p.nodes/p.seconds/1e6:0)<<" Mnps\n";
+}
+
+int main(int argc, char** argv) {
+    uint64_t maxNodes=2000000;
+    int benchDepth=BENCH_DEPTH;
+    for (int i=1;i<argc;i++) {
+        string a=argv[i];
+        if (a=="--max-nodes" && i+1<argc) maxNodes=strtoull(argv[++i],nullptr,10);
+        else if (a=="--bench-depth" && i+1<argc) benchDepth=max(1,atoi(argv[++i]));
+        else {
+            cerr<<"usage: backend_bench [--max-nodes N] [--bench-depth D]\n";
+            return 1;
+        }
+    }
+
+    vector<BackendResult> results;
+    results.push_back(runBackend<BitboardBoard>(maxNodes,benchDepth));
+    results.push_back(runBackend<Mailbox8x8Board>(maxNodes,benchDepth));
+    results.push_back(runBackend<Mailbox10x12Board>(maxNodes,benchDepth));
+
+    int mismatches=0;
+    const BackendResult& ref=results.front();
+    for (const BackendResult& r:results) {
+        bool same=r.suite.nodes==ref.suite.nodes && r.bench.nodes==ref.bench.nodes;
+        if (!same) mismatches++;
+        cout<<r.name<<(same?"":"  MISMATCH")<<"\n";
+        printRun("perft",r.suite);
+        printRun("bench",r.bench);
+    }
+    return mismatches?1:0;
+}
@@ -0,0 +1,24 @@
+// Microbenchmarks for the core rules primitives.
+//
+//   bench_micro [--json] [--samples N] [--sample-ms MS] [--filter NAME]
+#include "chess_microbench.h"
+
+int main(int argc, char** argv) {
+    MicroOptions opt;
+    bool json=false;
+    for (int i=1;i<argc;i++) {
+        string a=argv[i];
+        if (a=="--json") json=true;
+        else if (a=="--samples" && i+1<argc) opt.samples=max(1,atoi(argv[++i]));
+        else if (a=="--sample-ms" && i+1<argc) opt.targetSampleMs=atof(argv[++i]);
+        else if (a=="--filter" && i+1<argc) opt.filter=argv[++i];
+        else {
+            cerr<<"usage: bench_micro [--json] [--samples N] [--sample-ms MS] [--filter NAME]\n";
+            return 1;
+        }
+    }
+    vector<MicroResult> results=runMicroBenchmarks(opt);
+    if (json) printMicroResultsJson(results,cout);
+    else printMicroResults(results,cout);
+    return 0;
+}
@@ -1,457 +1,205 @@
-#include <iostream>
-#include <vector>
-#include <string>
-#include <cctype>
-#include <cmath>
-#include <unordered_map>
-#include <stack>
-
-using namespace std;
-
-// ================= ENUMS =================
-enum PieceType { EMPTY, PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
-enum Color { NONE, WHITE, BLACK };
-
-// ================= PIECE =================
-struct Piece {
-    PieceType type;
-    Color color;
-    bool hasMoved;
-    Piece() : type(EMPTY), color(NONE), hasMoved(false) {}
-    Piece(PieceType t, Color c) : type(t), color(c), hasMoved(false) {}
-};
-
-// ================= MOVE =================
-struct Move {
-    int fromRow, fromCol, toRow, toCol;
-    PieceType promotion;
-    bool isEnPassant, isCastling;
-    Move() : promotion(EMPTY), isEnPassant(false), isCastling(false) {}
-};
-
-// ================ MOVE HISTORY NODE =================
-struct MoveNode {
-    Move move;
-    MoveNode* prev;
-    MoveNode* next;
-    MoveNode(const Move& m) : move(m), prev(nullptr), next(nullptr) {}
-};
-
-// ================= GAME =================
-class ChessGame {
+#include "chess_engine.h"
+#include "chess_explorer.h"
+#include "chess_bench.h"
+#include "chess_selfplay.h"
+#include "chess_latency.h"
+#include "chess_trace.h"
+
+// ================= ENGINE SHELL =================
+// Line protocol used by chess_gui.py: every command is answered with the
+// BOARD/TURN/STATUS block from printState().
+class EngineShell {
 private:
-    Piece board[8][8];
-    Color currentPlayer;
-    int enPassantCol, enPassantRow;
-    int halfMoveClock;
-    unordered_map<string,int> positionCount;
-
-    struct GameState {
-        Piece board[8][8];
-        Color currentPlayer;
-        int enPassantCol, enPassantRow;
-        int halfMoveClock;
-        unordered_map<string,int> positionCount;
-    };
-
-    stack<GameState> undoStack;
-    stack<GameState> redoStack;
-
-    MoveNode* historyHead;
-    MoveNode* historyTail;
-    MoveNode* historyCurrent;
+    ChessGame game;
+    Searcher searcher;
+    OpeningExplorer explorer;
+    LatencyRecorder latency;
 
 public:
-    ChessGame() {
-        currentPlayer = WHITE;
-        enPassantCol = enPassantRow = -1;
-        halfMoveClock = 0;
-        historyHead = historyTail = historyCurrent = nullptr;
-        setupBoard();
-        positionCount[getPositionKey()]++;
-    }
-
-    ~ChessGame() {
-        MoveNode* n = historyHead;
-        while (n) {
-            MoveNode* next = n->next;
-            delete n;
-            n = next;
-        }
-    }
+    EngineShell() : searcher(game) {}
 
-    // ---------- SETUP ----------
-    void setupBoard() {
-        for (auto& r : board)
-            for (auto& c : r)
-                c = Piece();
+    bool openExplorer(const string& path) { return explorer.open(path); }
+    void dumpLatencyEvery(double seconds) { latency.setDumpInterval(seconds); }
 
-        PieceType back[] = {ROOK,KNIGHT,BISHOP,QUEEN,KING,BISHOP,KNIGHT,ROOK};
-        for (int i = 0; i < 8; i++) {
-            board[0][i] = Piece(back[i], BLACK);
-            board[1][i] = Piece(PAWN, BLACK);
-            board[6][i] = Piece(PAWN, WHITE);
-            board[7][i] = Piece(back[i], WHITE);
+    // ---------- EXPLORE ----------
+    void explore() {
+        if (!explorer.isOpen()) {
+            cout<<"ERROR NoExplorerIndex\n";
+            return;
         }
-    }
-
-    // ---------- HELPERS ----------
-    char getPieceChar(Piece p) {
-        if (p.type == EMPTY) return '.';
-        char map[] = {' ', 'P','N','B','R','Q','K'};
-        char ch = map[p.type];
-        return p.color == BLACK ? tolower(ch) : ch;
-    }
-
-    // displayBoard function was here
-
-    Color opponent(Color c) { return c == WHITE ? BLACK : WHITE; }
-    bool isValid(int r,int c) { return r>=0 && r<8 && c>=0 && c<8; }
-
-    void findKing(Color c,int &kr,int &kc) {
-        for (int r=0;r<8;r++)
-            for (int c2=0;c2<8;c2++)
-                if (board[r][c2].type==KING && board[r][c2].color==c) {
-                    kr=r; kc=c2; return;
-                }
-    }
-
-    // ---------- STATE SNAPSHOT ----------
-    GameState getState() {
-        GameState s;
-        for (int r = 0; r < 8; ++r)
-            for (int c = 0; c < 8; ++c)
-                s.board[r][c] = board[r][c];
-        s.currentPlayer = currentPlayer;
-        s.enPassantCol = enPassantCol;
-        s.enPassantRow = enPassantRow;
-        s.halfMoveClock = halfMoveClock;
-        s.positionCount = positionCount;
-        return s;
-    }
-
-    void setState(const GameState& s) {
-        for (int r = 0; r < 8; ++r)
-            for (int c = 0; c < 8; ++c)
-                board[r][c] = s.board[r][c];
-        currentPlayer = s.currentPlayer;
-        enPassantCol = s.enPassantCol;
-        enPassantRow = s.enPassantRow;
-        halfMoveClock = s.halfMoveClock;
-        positionCount = s.positionCount;
-    }
-
-    // ---------- MOVE HISTORY ----------
-
-    // truncateHistoryAfterCurrent function was here
-
-    void addMoveToHistory(const Move& m) {
-        MoveNode* node=new MoveNode(m);
-        if (!historyHead) {
-            historyHead=historyTail=historyCurrent=node;
-        } else {
-            node->prev=historyTail;
-            historyTail->next=node;
-            historyTail=node;
-            historyCurrent=node;
+        uint64_t key=game.repetitionKey();     // the key explorer_build indexes by
+        const ExplorerPosition* p=explorer.find(key);
+        cout<<"EXPLORE "<<hex<<key<<dec<<" GAMES "<<(p?p->postingCount:0)<<"\n";
+        if (!p) return;
+        const ExplorerMove* mv=explorer.moves(p);
+        for (uint32_t i=0;i<p->moveCount;i++)
+            cout<<"EXPLORE_MOVE "<<game.moveToString(unpackMove(mv[i].move))
+                <<" "<<mv[i].games<<" "<<mv[i].whiteWins
+                <<" "<<mv[i].draws<<" "<<mv[i].blackWins<<"\n";
+        const uint32_t* ids=explorer.postings(p);
+        cout<<"EXPLORE_GAMES";
+        for (uint32_t i=0;i<p->postingCount && i<10;i++) cout<<" "<<ids[i];
+        cout<<"\n";
+    }
+
+    // ---------- VARIATIONS ----------
+    // Moves already tried from the current position, oldest first; * marks
+    // the one REDO plays. MOVE with one of them re-enters that line.
+    void variations() {
+        const ChessGame::VariationNode* at=game.currentNode();
+        int n=0;
+        for (auto c=at->firstChild;c;c=c->nextSibling) n++;
+        cout<<"VARIATIONS "<<n<<"\n";
+        for (auto c=at->firstChild;c;c=c->nextSibling)
+            cout<<"VARIATION "<<game.moveToString(c->move)<<(c==at->lastVisited?" *":"")<<"\n";
+    }
+
+    // ---------- POSITION / GO ----------
+    // POSITION startpos | POSITION <fen>
+    void position(const string& args) {
+        string fen=args;
+        fen.erase(0,fen.find_first_not_of(' '));
+        if (fen.empty() || fen=="startpos") fen=START_FEN;
+        if (!game.loadFen(fen)) {
+            cout<<"ERROR InvalidFen\n";
+            game.loadFen(START_FEN);
         }
-    }
-
-    // moveToString and printMoveHistoryReport functions were here
-
-    // ---------- ATTACK CHECK ----------
-    bool isSquareAttacked(int tr,int tc,Color by) {
-        for (int r=0;r<8;r++)
-            for (int c=0;c<8;c++) {
-                Piece p=board[r][c];
-                if (p.color!=by) continue;
-
-                if (p.type==PAWN) {
-                    int dir=(by==WHITE?-1:1);
-                    if (r+dir==tr && abs(c-tc)==1) return true;
-                }
-                else if (canPieceMoveTo(r,c,tr,tc,true))
-                    return true;
-            }
-        return false;
-    }
-
-    bool isInCheck(Color c) {
-        int kr,kc;
-        findKing(c,kr,kc);
-        return isSquareAttacked(kr,kc,opponent(c));
-    }
-
-    // ---------- MOVE LOGIC ----------
-    bool canPieceMoveTo(int fr,int fc,int tr,int tc,bool ignoreCheck) {
-        Piece p=board[fr][fc];
-        if (p.type==EMPTY || board[tr][tc].color==p.color) return false;
-
-        int dr=tr-fr, dc=tc-fc;
-
-        if (p.type==PAWN) {
-            int dir=(p.color==WHITE?-1:1);
-            if (dc==0 && dr==dir && board[tr][tc].type==EMPTY) return true;
-            if (dc==0 && dr==2*dir && !p.hasMoved &&
-                board[fr+dir][fc].type==EMPTY &&
-                board[tr][tc].type==EMPTY) return true;
-            if (abs(dc)==1 && dr==dir) {
-                if (board[tr][tc].type!=EMPTY) return true;
-                if (tc==enPassantCol &&
-                    tr==(p.color==WHITE?2:5)) return true;
-            }
-            return false;
+        searcher.clear();
+    }
+
+    // GO [depth N] [nodes N] [movetime MS] [wtime MS btime MS winc MS binc MS movestogo N]
+    void go(const string& args) {
+        istringstream ss(args);
+        SearchLimits lim;
+        int64_t clock[3]={-1,-1,-1}, inc[3]={0,0,0};
+        int movesToGo=0;
+        string key;
+        long long v;
+        while (ss>>key>>v) {
+            if (key=="depth") lim.depth=(int)v;
+            else if (key=="nodes") lim.nodes=v;
+            else if (key=="movetime") lim.movetime=v;
+            else if (key=="wtime") clock[WHITE]=v;
+            else if (key=="btime") clock[BLACK]=v;
+            else if (key=="winc") inc[WHITE]=v;
+            else if (key=="binc") inc[BLACK]=v;
+            else if (key=="movestogo") movesToGo=(int)v;
         }
-
-        if (p.type==KNIGHT)
-            return (abs(dr)==2 && abs(dc)==1)||(abs(dr)==1 && abs(dc)==2);
-
-        if (p.type==KING) {
-            if (abs(dr)<=1 && abs(dc)<=1) return true;
-            if (!ignoreCheck && dr==0 && abs(dc)==2 && !p.hasMoved) {
-                int rookCol = dc>0?7:0;
-                int step = dc>0?1:-1;
-                if (board[fr][rookCol].type==ROOK &&
-                    !board[fr][rookCol].hasMoved) {
-                    for (int c=fc+step;c!=rookCol;c+=step)
-                        if (board[fr][c].type!=EMPTY) return false;
-                    if (!isSquareAttacked(fr,fc,opponent(p.color)) &&
-                        !isSquareAttacked(fr,fc+step,opponent(p.color)) &&
-                        !isSquareAttacked(tr,tc,opponent(p.color)))
-                        return true;
-                }
-            }
-            return false;
+        Color us=game.sideToMove();
+        if (clock[us]>=0) lim.movetime=allocateTime(clock[us],inc[us],movesToGo);
+        if (!game.hasLegalMove()) {
+            cout<<"BESTMOVE none\n";
+            return;
         }
-
-        bool diag=abs(dr)==abs(dc);
-        bool straight=dr==0||dc==0;
-        if (p.type==BISHOP && !diag) return false;
-        if (p.type==ROOK && !straight) return false;
-        if (p.type==QUEEN && !(diag||straight)) return false;
-
-        int sr=(dr>0)-(dr<0), sc=(dc>0)-(dc<0);
-        for (int r=fr+sr,c=fc+sc;r!=tr||c!=tc;r+=sr,c+=sc)
-            if (board[r][c].type!=EMPTY) return false;
-
-        return true;
+        SearchInfo info=searcher.search(lim);
+        cout<<"BESTMOVE "<<game.moveToString(info.best)<<" SCORE "<<info.score
+            <<" DEPTH "<<info.depth<<" NODES "<<info.nodes<<"\n";
     }
 
-    bool testMove(int fr,int fc,int tr,int tc) {
-        Piece a=board[fr][fc], b=board[tr][tc];
-        board[tr][tc]=a; board[fr][fc]=Piece();
-        bool ok=!isInCheck(a.color);
-        board[fr][fc]=a; board[tr][tc]=b;
-        return ok;
-    }
-
-    vector<Move> getLegalMoves(Color c) {
-        vector<Move> moves;
-        for (int r=0;r<8;r++)
-            for (int col=0;col<8;col++)
-                if (board[r][col].color==c)
-                    for (int tr=0;tr<8;tr++)
-                        for (int tc=0;tc<8;tc++)
-                            if (canPieceMoveTo(r,col,tr,tc,false) &&
-                                testMove(r,col,tr,tc)) {
-                                Move m;
-                                m.fromRow=r; m.fromCol=col;
-                                m.toRow=tr;  m.toCol=tc;
-                                if (board[r][col].type==KING && abs(tc-col)==2)
-                                    m.isCastling=true;
-                                if (board[r][col].type==PAWN &&
-                                    tc==enPassantCol &&
-                                    tr==(c==WHITE?2:5))
-                                    m.isEnPassant=true;
-                                if (board[r][col].type==PAWN &&
-                                   (tr==0||tr==7)) {
-                                    PieceType ps[]={QUEEN,ROOK,BISHOP,KNIGHT};
-                                    for (auto p:ps){Move pm=m;pm.promotion=p;moves.push_back(pm);}
-                                } else moves.push_back(m);
-                            }
-        return moves;
-    }
-
-    // ---------- STATUS ----------
-    string getPositionKey() {
-        string k;
-        for (int r=0;r<8;r++)
-            for (int c=0;c<8;c++){
-                k+=char('0'+board[r][c].type);
-                k+=char('0'+board[r][c].color);
-            }
-        k+=char('0'+currentPlayer);
-        return k;
-    }
-
-    bool insufficientMaterial() {
-        int minor=0;
-        for (auto&r:board)for(auto&p:r)
-            if (p.type!=EMPTY && p.type!=KING) {
-                if (p.type==BISHOP||p.type==KNIGHT) minor++;
-                else return false;
-            }
-        return minor<=1;
-    }
-
-    string getGameStatus() {
-        if (positionCount[getPositionKey()]>=3) return "draw (threefold repetition)";
-        if (halfMoveClock>=100) return "draw (50-move rule)";
-        if (insufficientMaterial()) return "draw (insufficient material)";
-
-        auto moves=getLegalMoves(currentPlayer);
-        if (moves.empty())
-            return isInCheck(currentPlayer)?"checkmate":"stalemate";
-        if (isInCheck(currentPlayer)) return "check";
-        return "active";
-    }
-
-
-    // ---------- MAKE MOVE ----------
-    void makeMove(Move m) {
-    undoStack.push(getState());
-    while (!redoStack.empty()) redoStack.pop();
-    addMoveToHistory(m);
-
-    Piece p=board[m.fromRow][m.fromCol];
-    if (p.type==PAWN || board[m.toRow][m.toCol].type!=EMPTY)
-        halfMoveClock=0;
-    else halfMoveClock++;
-
-    // 🔥 FIX: En Passant - remove the captured pawn (it's NOT at the target square!)
-    if (m.isEnPassant) {
-        // The captured pawn is one row back from where we're moving
-        int capturedPawnRow = (p.color == WHITE) ? m.toRow + 1 : m.toRow - 1;
-        board[capturedPawnRow][m.toCol] = Piece();
-    }
-
-    // Update en passant tracking
-    enPassantCol=enPassantRow=-1;
-    if (p.type==PAWN && abs(m.toRow-m.fromRow)==2) {
-        enPassantCol=m.toCol;
-        enPassantRow=m.toRow;  // This is the target row for en passant capture
-    }
-
-    // Handle castling
-    if (m.isCastling) {
-        int rookFrom = m.toCol>m.fromCol?7:0;
-        int rookTo   = m.toCol>m.fromCol?m.toCol-1:m.toCol+1;
-        board[m.fromRow][rookTo]=board[m.fromRow][rookFrom];
-        board[m.fromRow][rookFrom]=Piece();
-    }
-
-    // Move the piece
-    board[m.toRow][m.toCol]=p;
-    board[m.toRow][m.toCol].hasMoved=true;
-    board[m.fromRow][m.fromCol]=Piece();
-
-    // Handle promotion
-    if (m.promotion!=EMPTY)
-        board[m.toRow][m.toCol].type=m.promotion;
-
-    currentPlayer=opponent(currentPlayer);
-    positionCount[getPositionKey()]++;
-}
-
-    void undo() {
-        if (undoStack.empty()) return;
-        // Save current state to redo stack
-        redoStack.push(getState());
-        // Restore previous state
-        GameState prev = undoStack.top();
-        undoStack.pop();
-        setState(prev);
-
-        // Move historyCurrent one step back (if possible)
-        if (historyCurrent) {
-            historyCurrent = historyCurrent->prev;
-        }
-    }
-
-    void redo() {
-        if (redoStack.empty()) return;
-        // Save current state to undo stack
-        undoStack.push(getState());
-        // Restore next state
-        GameState next = redoStack.top();
-        redoStack.pop();
-        setState(next);
-
-        // Move historyCurrent one step forward (if possible)
-        if (!historyCurrent) {
-            historyCurrent = historyHead;
-        } else if (historyCurrent->next) {
-            historyCurrent = historyCurrent->next;
-        }
-    }
-
-    bool parseMove(string s,Move &m) {
-        if (s.size()<4) return false;
-        for(char &c:s)c=tolower(c);
-        m.fromCol=s[0]-'a'; m.fromRow=8-(s[1]-'0');
-        m.toCol=s[2]-'a';   m.toRow=8-(s[3]-'0');
-        if (s.size()>=5) {
-            char p=toupper(s[4]);
-            if (p=='Q')m.promotion=QUEEN;
-            if (p=='R')m.promotion=ROOK;
-            if (p=='B')m.promotion=BISHOP;
-            if (p=='N')m.promotion=KNIGHT;
-        }
-        return isValid(m.fromRow,m.fromCol)&&isValid(m.toRow,m.toCol);
-    }
-
-    // ---------- STREAMLIT-FRIENDLY OUTPUT ----------
-    void printState() {
-        cout << "BOARD\n";
-        for (int r=0;r<8;r++) {
-            for (int c=0;c<8;c++) {
-                cout << getPieceChar(board[r][c]);
-                if (c<7) cout<<" ";
-            }
-            cout<<"\n";
-        }
-        cout << "TURN " << (currentPlayer==WHITE?"WHITE":"BLACK") << "\n";
-        cout << "STATUS " << getGameStatus() << "\n";
-        cout << flush;
+    // ---------- STATS ----------
+    // STATS | STATS LATENCY | STATS MEMORY | STATS RESET
+    void stats(const string& args) {
+        istringstream ss(args);
+        string sub;
+        ss>>sub;
+        if (sub=="RESET") { statRegistry().reset(); latency.reset(); }
+        else if (sub=="LATENCY") latency.print(cout);
+        else if (sub=="MEMORY") printMemory(cout);
+        else printStats(cout);
     }
 
     // ---------- COMMAND LOOP ----------
     void play() {
-        printState();
+        game.printState();
         string cmd;
         while (cin >> cmd) {
+            // command latency stops before the reply, which is timed as STATUS
+            auto t0=chrono::steady_clock::now();
+            int kind=latencyKind(cmd);
+            TraceSpan span("command",cmd.c_str());
+            auto respond=[&]() {
+                latency.record(kind,t0);
+                auto t1=chrono::steady_clock::now();
+                TraceSpan reply("command","STATUS");
+                game.printState();
+                latency.record(LAT_STATUS,t1);
+                latency.maybeDump(cerr);
+            };
             if (cmd=="QUIT") break;
-            else if (cmd=="UNDO") undo();
-            else if (cmd=="REDO") redo();
+            else if (cmd=="UNDO") game.undo();
+            else if (cmd=="REDO") game.redo();
+            else if (cmd=="EXPLORE") explore();
+            else if (cmd=="VARIATIONS") variations();
+            else if (cmd=="GOTO") {
+                string s; cin >> s;
+                bool number=!s.empty() && s.find_first_not_of("0123456789")==string::npos;
+                if (!number || !game.goTo(atoi(s.c_str()))) cout<<"ERROR InvalidPly\n";
+            }
+            else if (cmd=="POSITION" || cmd=="GO" || cmd=="BENCH" || cmd=="STATS") {
+                string args; getline(cin,args);
+                if (cmd=="GO") go(args);
+                else if (cmd=="STATS") stats(args);
+                else if (cmd=="BENCH") {
+                    int depth=atoi(args.c_str());
+                    runBench(depth>0?depth:BENCH_DEPTH,cout);
+                }
+                else position(args);
+            }
             else if (cmd=="MOVE") {
                 string s; cin >> s;
                 Move u,a;
-                if (!parseMove(s,u)) {
+                if (!game.parseMove(s,u)) {
                     cout<<"ERROR InvalidMove\n"<<flush;
-                    printState();        // 🔥 ADD THIS, for a GUI ERROR
+                    respond();   // 🔥 ADD THIS, for a GUI ERROR
                     continue;
                 }
-                bool ok=false;
-                for (auto m:getLegalMoves(currentPlayer))
-                    if (m.fromRow==u.fromRow&&m.fromCol==u.fromCol&&
-                        m.toRow==u.toRow&&m.toCol==u.toCol) {
-                        a=m; ok=true; break;
-                    }
-                if (!ok) {
+                if (!game.findLegalMove(u,a)) {
                     cout<<"ERROR IllegalMove\n"<<flush;
-                    printState();        // 🔥 ADD THIS, for a GUI ERROR
+                    respond();   // 🔥 ADD THIS, for a GUI ERROR
                     continue;
                 }
-                makeMove(a);
+                game.makeMove(a);
             }
-            printState();
+            respond();
         }
     }
 };
 
 // ================= MAIN =================
-int main() {
-    ChessGame game;
-    game.play();
+static int runMain(int argc, char** argv) {
+    if (argc>1 && string(argv[1])=="bench")
+        return benchMain(vector<string>(argv+2,argv+argc));
+    if (argc>1 && string(argv[1])=="selfplay")
+        return selfplayMain(vector<string>(argv+2,argv+argc));
+
+    EngineShell shell;
+    for (int i=1;i<argc;i++) {
+        string arg=argv[i];
+        if (arg=="--explorer" && i+1<argc) {
+            if (!shell.openExplorer(argv[++i]))
+                cerr<<"cannot open explorer index "<<argv[i]<<"\n";
+        }
+        else if (arg=="--latency-dump" && i+1<argc)
+            shell.dumpLatencyEvery(atof(argv[++i]));
+    }
+    shell.play();
     return 0;
-}
\ No newline at end of file
+}
+
+// --trace <file> may appear anywhere on the command line; it is stripped
+// before dispatch and the trace is written once everything has finished.
+int main(int argc, char** argv) {
+    vector<char*> args(argv,argv+argc);
+    for (size_t i=1;i+1<args.size();i++)
+        if (string(args[i])=="--trace") {
+            tracer().start(args[i+1]);
+            args.erase(args.begin()+i,args.begin()+i+2);
+            break;
+        }
+    int rc=runMain((int)args.size(),args.data());
+    if (tracer().enabled() && !tracer().flush()) {
+        cerr<<"cannot write trace "<<tracer().file()<<"\n";
+        return rc?rc:1;
+    }
+    return rc;
+}
@@ -0,0 +1,159 @@
+#ifndef CHESS_ARENA_H
+#define CHESS_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#include "chess_memory.h"
+
+// ================= SLAB POOL =================
+// Fixed-size slots carved from slabs that are never returned to the system.
+// Each thread keeps a short free list of its own and trades slots with the
+// shared list in batches, so concurrent sessions rarely touch the lock.
+// One pool per (slot size, memory category) pair; slab bytes are charged to
+// the category as they are reserved.
+template<size_t SLOT_BYTES,int CATEGORY>
+class SlabPool {
+private:
+    static constexpr size_t SLOT=(SLOT_BYTES+15)&~size_t(15);
+    static constexpr size_t SLOTS_PER_SLAB=SLOT>=16384?4:65536/SLOT;
+    static constexpr int BATCH=SLOTS_PER_SLAB<8?(int)SLOTS_PER_SLAB:8;
+
+    struct FreeSlot { FreeSlot* next; };
+
+    struct ThreadCache {
+        FreeSlot* head=nullptr;
+        int count=0;
+        ~ThreadCache() { instance().give(head); }
+    };
+
+    std::mutex lock;
+    FreeSlot* shared=nullptr;
+
+    static ThreadCache& cache() {
+        static thread_local ThreadCache c;
+        return c;
+    }
+
+    // Moves up to BATCH slots from the shared list into the calling thread's
+    // cache, reserving a new slab when the shared list is empty.
+    void refill(ThreadCache& c) {
+        std::lock_guard<std::mutex> g(lock);
+        if (!shared) {
+            unsigned char* slab=(unsigned char*)::operator new(SLOT*SLOTS_PER_SLAB);
+            memoryAdd(CATEGORY,SLOT*SLOTS_PER_SLAB);
+            for (size_t i=0;i<SLOTS_PER_SLAB;i++) {
+                FreeSlot* s=(FreeSlot*)(slab+i*SLOT);
+                s->next=shared;
+                shared=s;
+            }
+        }
+        for (int i=0;i<BATCH && shared;i++) {
+            FreeSlot* s=shared;
+            shared=s->next;
+            s->next=c.head;
+            c.head=s;
+            c.count++;
+        }
+    }
+
+    void give(FreeSlot* list) {
+        if (!list) return;
+        FreeSlot* tail=list;
+        while (tail->next) tail=tail->next;
+        std::lock_guard<std::mutex> g(lock);
+        tail->next=shared;
+        shared=list;
+    }
+
+public:
+    // Leaked on purpose: thread caches flush into it during thread and
+    // process exit, after ordinary statics may already be gone.
+    static SlabPool& instance() {
+        static SlabPool* pool=new SlabPool;
+        return *pool;
+    }
+
+    void* allocate() {
+        ThreadCache& c=cache();
+        if (!c.head) refill(c);
+        FreeSlot* s=c.head;
+        c.head=s->next;
+        c.count--;
+        return s;
+    }
+
+    void deallocate(void* p) {
+        ThreadCache& c=cache();
+        FreeSlot* s=(FreeSlot*)p;
+        s->next=c.head;
+        c.head=s;
+        if (++c.count>2*BATCH) {
+            FreeSlot* batch=c.head;
+            FreeSlot* last=batch;
+            for (int i=1;i<BATCH;i++) last=last->next;
+            c.head=last->next;
+            last->next=nullptr;
+            c.count-=BATCH;
+            give(batch);
+        }
+    }
+};
+
+// ================= ARENA =================
+// Bump allocator over fixed-size blocks from a SlabPool. Nothing is freed
+// individually: reset() rewinds to the first block and keeps the chain for
+// reuse, the destructor hands the blocks back to the pool.
+class Arena {
+public:
+    static constexpr size_t BLOCK_BYTES=64*1024;
+
+private:
+    struct Block { Block* next; };
+    typedef SlabPool<BLOCK_BYTES,MEM_ARENA> BlockPool;
+    static constexpr size_t HEADER=(sizeof(Block)+15)&~size_t(15);
+
+    Block* first;
+    Block* current;
+    size_t offset;              // next free byte in current
+
+    Block* newBlock() {
+        Block* b=(Block*)BlockPool::instance().allocate();
+        b->next=nullptr;
+        return b;
+    }
+
+public:
+    static constexpr size_t MAX_ALLOCATION=BLOCK_BYTES-HEADER;
+
+    Arena() : first(nullptr), current(nullptr), offset(HEADER) {}
+    ~Arena() {
+        while (first) {
+            Block* next=first->next;
+            BlockPool::instance().deallocate(first);
+            first=next;
+        }
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // n must not exceed MAX_ALLOCATION.
+    void* allocate(size_t n,size_t align=alignof(max_align_t)) {
+        size_t at=(offset+align-1)&~(align-1);
+        if (!current || at+n>BLOCK_BYTES) {
+            if (!current) current=first?first:(first=newBlock());
+            else current=current->next?current->next:(current->next=newBlock());
+            at=HEADER;
+        }
+        offset=at+n;
+        return (unsigned char*)current+at;
+    }
+
+    // Invalidates everything allocated so far.
+    void reset() { current=nullptr; offset=HEADER; }
+};
+
+#endif // CHESS_ARENA_H
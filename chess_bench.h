@@ -0,0 +1,389 @@
+#ifndef CHESS_BENCH_H
+#define CHESS_BENCH_H
+
+#include "chess_engine.h"
+#include "chess_latency.h"
+#include "chess_search.h"
+
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+// ================= EPD TEST SUITES =================
+struct EpdPosition {
+    string fen, id;
+    vector<string> bestMoves, avoidMoves;   // SAN, from the bm / am opcodes
+};
+
+// "<4 FEN fields> bm Nf3 Qg6; am Qxb2; id "WAC.001";"
+inline bool parseEpdLine(const string& line,EpdPosition& e) {
+    istringstream ss(line);
+    string fields[4];
+    for (auto& f:fields)
+        if (!(ss>>f)) return false;
+    e.fen=fields[0]+" "+fields[1]+" "+fields[2]+" "+fields[3];
+    string rest;
+    getline(ss,rest);
+    size_t pos=0;
+    while (pos<rest.size()) {
+        size_t semi=rest.find(';',pos);
+        if (semi==string::npos) semi=rest.size();
+        istringstream op(rest.substr(pos,semi-pos));
+        string code, arg;
+        op>>code;
+        if (code=="bm" || code=="am") {
+            while (op>>arg) (code=="bm"?e.bestMoves:e.avoidMoves).push_back(arg);
+        } else if (code=="id") {
+            getline(op,arg);
+            size_t q1=arg.find('"'), q2=arg.rfind('"');
+            e.id=(q1!=string::npos && q2>q1)?arg.substr(q1+1,q2-q1-1):arg;
+        }
+        pos=semi+1;
+    }
+    return true;
+}
+
+// "movetime=500", "nodes=20000", "depth=6"; a bare number is a movetime.
+inline bool parseSearchLimit(const string& arg,SearchLimits& lim) {
+    size_t eq=arg.find('=');
+    string key=eq==string::npos?"movetime":arg.substr(0,eq);
+    string val=eq==string::npos?arg:arg.substr(eq+1);
+    if (val.empty() || !isdigit((unsigned char)val[0])) return false;
+    long long v=atoll(val.c_str());
+    if (key=="movetime") lim.movetime=v;
+    else if (key=="nodes") lim.nodes=v;
+    else if (key=="depth") lim.depth=(int)v;
+    else return false;
+    return true;
+}
+
+struct EpdResult {
+    bool valid, solved;
+    string found;
+    int64_t solveTime;      // ms at which the final solving move was first found
+    uint64_t nodes;
+};
+
+inline double percentile(vector<int64_t> v,double p) {
+    sort(v.begin(),v.end());
+    return (double)sortedPercentile(v,p);
+}
+
+// Reads an EPD file, numbering positions without an id; complains on stderr.
+inline bool loadEpdFile(const string& path,vector<EpdPosition>& suite) {
+    ifstream in(path);
+    if (!in) {
+        cerr<<"cannot open EPD file "<<path<<"\n";
+        return false;
+    }
+    string line;
+    while (getline(in,line)) {
+        if (!line.empty() && line.back()=='\r') line.pop_back();
+        EpdPosition e;
+        if (line.empty() || line[0]=='#' || !parseEpdLine(line,e)) continue;
+        if (e.id.empty()) e.id="#"+to_string(suite.size()+1);
+        suite.push_back(e);
+    }
+    if (suite.empty()) {
+        cerr<<"no positions in "<<path<<"\n";
+        return false;
+    }
+    return true;
+}
+
+// Runs the suite with positions handed out to worker threads; each worker
+// owns its own ChessGame and Searcher (and so its own hash table).
+inline int runEpdBench(const string& path,const SearchLimits& limits,int threads) {
+    vector<EpdPosition> suite;
+    if (!loadEpdFile(path,suite)) return 1;
+    threads=max(1,min(threads,(int)suite.size()));
+
+    vector<EpdResult> results(suite.size());
+    atomic<size_t> next(0);
+    auto t0=chrono::steady_clock::now();
+
+    auto worker=[&]() {
+        ChessGame game;
+        Searcher searcher(game);
+        size_t i;
+        while ((i=next++)<suite.size()) {
+            const EpdPosition& e=suite[i];
+            EpdResult& r=results[i];
+            r.valid=false; r.solved=false; r.solveTime=-1; r.nodes=0;
+            if (!game.loadFen(e.fen)) continue;
+
+            vector<uint16_t> bm, am;
+            bool ok=!e.bestMoves.empty() || !e.avoidMoves.empty();
+            for (auto& s:e.bestMoves) { Move m; if (game.parseSan(s,m)) bm.push_back(packMove(m)); else ok=false; }
+            for (auto& s:e.avoidMoves) { Move m; if (game.parseSan(s,m)) am.push_back(packMove(m)); else ok=false; }
+            if (!ok) continue;
+            r.valid=true;
+
+            auto solves=[&](const Move& m) {
+                uint16_t p=packMove(m);
+                if (!bm.empty() && find(bm.begin(),bm.end(),p)==bm.end()) return false;
+                return find(am.begin(),am.end(),p)==am.end();
+            };
+            int64_t firstSolved=-1;
+            searcher.clear();
+            searcher.onIteration=[&](const SearchInfo& info) {
+                if (!solves(info.best)) firstSolved=-1;
+                else if (firstSolved<0) firstSolved=info.elapsed;
+            };
+            SearchInfo info=searcher.search(limits);
+            r.found=game.moveToString(info.best);
+            r.solved=solves(info.best);
+            r.solveTime=r.solved?(firstSolved<0?info.elapsed:firstSolved):-1;
+            r.nodes=info.nodes;
+        }
+    };
+    vector<thread> pool;
+    for (int t=0;t<threads;t++) pool.emplace_back(worker);
+    for (auto& t:pool) t.join();
+    int64_t wall=chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now()-t0).count();
+
+    int solved=0, invalid=0;
+    uint64_t totalNodes=0;
+    vector<int64_t> times;
+    int64_t buckets[5]={0,0,0,0,0};     // <10ms <100ms <1s <10s >=10s
+    for (size_t i=0;i<suite.size();i++) {
+        const EpdResult& r=results[i];
+        if (!r.valid) {
+            invalid++;
+            cout<<setw(5)<<i+1<<" "<<suite[i].id<<"  invalid\n";
+            continue;
+        }
+        totalNodes+=r.nodes;
+        cout<<setw(5)<<i+1<<" "<<suite[i].id<<"  "<<(r.solved?"solved  ":"failed  ")
+            <<r.found<<"  nodes "<<r.nodes;
+        if (r.solved) {
+            cout<<"  time "<<r.solveTime<<" ms";
+            solved++;
+            times.push_back(r.solveTime);
+            int b=r.solveTime<10?0:r.solveTime<100?1:r.solveTime<1000?2:r.solveTime<10000?3:4;
+            buckets[b]++;
+        }
+        cout<<"\n";
+    }
+    cout<<"\nSolved        : "<<solved<<" / "<<suite.size()-invalid;
+    if (invalid) cout<<" ("<<invalid<<" invalid)";
+    cout<<"\nTime to solve : <10ms "<<buckets[0]<<", <100ms "<<buckets[1]
+        <<", <1s "<<buckets[2]<<", <10s "<<buckets[3]<<", >=10s "<<buckets[4]<<"\n";
+    cout<<"                median "<<percentile(times,0.5)<<" ms, p90 "
+        <<percentile(times,0.9)<<" ms, max "<<percentile(times,1.0)<<" ms\n";
+    cout<<"Total nodes   : "<<totalNodes<<"\n";
+    cout<<"Threads       : "<<threads<<"\n";
+    cout<<"Wall time     : "<<wall<<" ms\n";
+    cout<<"Nodes/second  : "<<(wall>0?totalNodes*1000/wall:totalNodes)<<"\n";
+    return 0;
+}
+
+// ================= BENCH =================
+// Fixed positions searched to a fixed depth with a cleared hash table each,
+// so the total node count is a functional signature of the build.
+static const char* const BENCH_FENS[]={
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+    "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+    "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+    "8/8/8/8/8/6k1/6p1/6K1 w - - 0 1",
+    "7k/7P/6K1/8/3B4/8/8/8 b - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P3/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1",
+};
+static const int BENCH_POSITIONS=sizeof(BENCH_FENS)/sizeof(BENCH_FENS[0]);
+static const int BENCH_DEPTH=4;
+
+struct BenchResult {
+    uint64_t nodes;
+    int64_t elapsed;    // ms
+};
+
+// Board selects the backend (backend_bench); the engine's bench is bitboard.
+template<class Board=BitboardBoard>
+inline BenchResult runBench(int depth,ostream& out) {
+    BasicChessGame<Board> game;
+    BasicSearcher<BasicChessGame<Board>> searcher(game);
+    SearchLimits lim;
+    lim.depth=depth;
+    BenchResult r;
+    r.nodes=0;
+#ifdef CHESS_STATS
+    statRegistry().reset();
+#endif
+    auto t0=chrono::steady_clock::now();
+    for (int i=0;i<BENCH_POSITIONS;i++) {
+        game.loadFen(BENCH_FENS[i]);
+        searcher.clear();
+        SearchInfo info=searcher.search(lim);
+        r.nodes+=info.nodes;
+        out<<"Position "<<setw(2)<<i+1<<"/"<<BENCH_POSITIONS<<"  nodes "<<info.nodes<<"\n";
+    }
+    r.elapsed=chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now()-t0).count();
+    out<<"===========================\n";
+    out<<"Total time (ms) : "<<r.elapsed<<"\n";
+    out<<"Nodes searched  : "<<r.nodes<<"\n";
+    out<<"Nodes/second    : "<<(r.elapsed>0?r.nodes*1000/r.elapsed:r.nodes)<<"\n";
+    out<<"Kernels         : "<<kernels().isa<<"\n";
+#ifdef CHESS_STATS
+    printStats(out);
+#endif
+    return r;
+}
+
+// ================= TREE SHAPE =================
+// Searches each position to `depth` with shape recording on and prints, per
+// iteration summed over all positions: nodes, effective branching factor
+// (against the previous iteration), quiescence share, first-move cutoff
+// rate, TT hit rate, LMR reductions and re-searches; then the TT hit rate by
+// remaining depth.
+inline void printShape(const SearchShape& s,bool json,ostream& out) {
+    auto pct=[](uint64_t a,uint64_t b) { return b?100.0*a/b:0.0; };
+    uint64_t probes[SHAPE_DEPTHS]={}, hits[SHAPE_DEPTHS]={};
+    for (auto& it:s.iterations)
+        for (int d=0;d<SHAPE_DEPTHS;d++) { probes[d]+=it.ttProbes[d]; hits[d]+=it.ttHits[d]; }
+    out<<fixed<<setprecision(2);
+    if (json) out<<"{\n  \"iterations\": [\n";
+    else out<<setw(5)<<"depth"<<setw(12)<<"nodes"<<setw(8)<<"ebf"<<setw(8)<<"q%"
+            <<setw(9)<<"1st-cut%"<<setw(8)<<"tt-hit%"<<setw(10)<<"reduced"<<setw(10)<<"re-search"
+            <<setw(10)<<"pvs-re"<<"\n";
+    for (size_t i=0;i<s.iterations.size();i++) {
+        const ShapeIteration& it=s.iterations[i];
+        uint64_t total=it.nodes+it.qnodes, itProbes=0, itHits=0;
+        for (int d=0;d<SHAPE_DEPTHS;d++) { itProbes+=it.ttProbes[d]; itHits+=it.ttHits[d]; }
+        uint64_t prev=i?s.iterations[i-1].nodes+s.iterations[i-1].qnodes:0;
+        double ebf=prev?double(total)/prev:0;
+        if (json)
+            out<<"    {\"depth\": "<<i+1<<", \"nodes\": "<<it.nodes<<", \"qnodes\": "<<it.qnodes
+               <<", \"ebf\": "<<ebf<<", \"qshare\": "<<pct(it.qnodes,total)
+               <<", \"first_move_cutoff\": "<<pct(it.firstMoveCutoffs,it.cutoffs)
+               <<", \"tt_hit\": "<<pct(itHits,itProbes)<<", \"reductions\": "<<it.reductions
+               <<", \"re_searches\": "<<it.reSearches<<", \"pvs_re_searches\": "<<it.pvsReSearches
+               <<"}"<<(i+1<s.iterations.size()?",":"")<<"\n";
+        else
+            out<<setw(5)<<i+1<<setw(12)<<total<<setw(8)<<ebf<<setw(8)<<pct(it.qnodes,total)
+               <<setw(9)<<pct(it.firstMoveCutoffs,it.cutoffs)<<setw(8)<<pct(itHits,itProbes)
+               <<setw(10)<<it.reductions<<setw(10)<<it.reSearches<<setw(10)<<it.pvsReSearches<<"\n";
+    }
+    if (json) out<<"  ],\n  \"tt_by_depth\": [";
+    else out<<"\nTT hit rate by remaining depth\n";
+    bool first=true;
+    for (int d=0;d<SHAPE_DEPTHS;d++) {
+        if (!probes[d]) continue;
+        if (json) out<<(first?"\n":",\n")<<"    {\"depth\": "<<d<<", \"probes\": "<<probes[d]
+                     <<", \"hits\": "<<hits[d]<<"}";
+        else out<<setw(5)<<d<<setw(12)<<probes[d]<<setw(8)<<pct(hits[d],probes[d])<<"%\n";
+        first=false;
+    }
+    if (json) out<<"\n  ]\n}\n";
+}
+
+inline int runShape(int depth,const vector<string>& fens,bool json) {
+    ChessGame game;
+    Searcher searcher(game);
+    SearchShape shape;
+    searcher.recordShape(&shape);
+    SearchLimits lim;
+    lim.depth=depth;
+    for (auto& fen:fens) {
+        if (!game.loadFen(fen)) { cerr<<"bad FEN "<<fen<<"\n"; continue; }
+        searcher.clear();
+        searcher.search(lim);
+    }
+    printShape(shape,json,cout);
+    return 0;
+}
+
+// ================= BENCH COMMAND LINE =================
+//   bench [depth]
+//   bench epd <file> <movetime|nodes> [threads=N]
+//   bench shape [depth] [epd=<file>] [--json]
+inline int benchMain(const vector<string>& args) {
+    if (!args.empty() && args[0]=="shape") {
+        int depth=BENCH_DEPTH+1;
+        bool json=false;
+        vector<string> fens(BENCH_FENS,BENCH_FENS+BENCH_POSITIONS);
+        for (size_t i=1;i<args.size();i++) {
+            if (args[i]=="--json") json=true;
+            else if (args[i].compare(0,4,"epd=")==0) {
+                vector<EpdPosition> suite;
+                if (!loadEpdFile(args[i].substr(4),suite)) return 1;
+                fens.clear();
+                for (auto& e:suite) fens.push_back(e.fen);
+            }
+            else if (isdigit((unsigned char)args[i][0])) depth=atoi(args[i].c_str());
+        }
+        if (depth<=0) {             // depth 0 would search without a limit
+            cerr<<"bench shape: depth must be at least 1\n";
+            return 1;
+        }
+        return runShape(depth,fens,json);
+    }
+    if (args.size()>=3 && args[0]=="epd") {
+        SearchLimits lim;
+        if (!parseSearchLimit(args[2],lim)) {
+            cerr<<"bad search limit "<<args[2]<<"\n";
+            return 1;
+        }
+        int threads=max(1u,thread::hardware_concurrency());
+        for (size_t i=3;i<args.size();i++)
+            if (args[i].compare(0,8,"threads=")==0) threads=atoi(args[i].c_str()+8);
+        return runEpdBench(args[1],lim,threads);
+    }
+    // depth 0 means no limit, so it falls through to the usage message
+    int depth=args.empty()?BENCH_DEPTH:args.size()==1 && isdigit((unsigned char)args[0][0])?atoi(args[0].c_str()):0;
+    if (depth>0) {
+        runBench(depth,cout);
+        return 0;
+    }
+    cerr<<"usage: bench [depth]\n"
+          "       bench epd <file> <movetime=ms|nodes=n|depth=d> [threads=N]\n"
+          "       bench shape [depth] [epd=<file>] [--json]\n";
+    return 1;
+}
+
+#endif // CHESS_BENCH_H
@@ -0,0 +1,263 @@
+#ifndef CHESS_BOARD_H
+#define CHESS_BOARD_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "chess_kernels.h"
+
+// ================= ENUMS =================
+enum PieceType { EMPTY, PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+enum Color { NONE, WHITE, BLACK };
+
+// ================= PIECE =================
+struct Piece {
+    PieceType type;
+    Color color;
+    bool hasMoved;
+    Piece() : type(EMPTY), color(NONE), hasMoved(false) {}
+    Piece(PieceType t, Color c) : type(t), color(c), hasMoved(false) {}
+};
+
+// ================= BOARD BACKENDS =================
+// Piece placement behind the rules code in BasicChessGame. A backend
+// provides, with squares numbered row*8+col (row 0 = rank 8):
+//
+//   static const char* name();
+//   void clear();                          empty board
+//   Piece at(int r,int c) const;
+//   void set(int r,int c,Piece p);         the only write; keeps derived state
+//   bool attacked(int sq,Color by) const;
+//   bool pathClear(int from,int to) const; squares strictly between are empty
+//   int kingSquare(Color c) const;         -1 without a king
+//   uint64_t occupancy(Color c) const;     bit per square holding a piece of c
+//   template<class F> void forEach(Color c,F f) const;
+//                                          f(sq) per piece of c, ascending sq
+//
+// Make/unmake is written once in BasicChessGame on top of set(), so every
+// backend plays the same moves in the same order.
+
+// ---------- bitboards ----------
+// Square array plus one bitboard per piece kind: attacks go through the ISA
+// kernels and the between table. The engine's default.
+class BitboardBoard {
+private:
+    Piece squares[64];
+    Bitboards bb;
+
+public:
+    static const char* name() { return "bitboard"; }
+
+    BitboardBoard() { clear(); }
+
+    void clear() {
+        for (auto& p:squares) p=Piece();
+        memset(&bb,0,sizeof(bb));
+    }
+
+    Piece at(int r,int c) const { return squares[r*8+c]; }
+
+    void set(int r,int c,Piece p) {
+        uint64_t bit=1ULL<<(r*8+c);
+        Piece& old=squares[r*8+c];
+        if (old.type!=EMPTY) { bb.pieces[old.color][old.type]&=~bit; bb.color[old.color]&=~bit; }
+        if (p.type!=EMPTY) { bb.pieces[p.color][p.type]|=bit; bb.color[p.color]|=bit; }
+        old=p;
+    }
+
+    bool attacked(int sq,Color by) const { return kernels().squareAttacked(bb,sq,by); }
+
+    bool pathClear(int from,int to) const {
+        return !(lineTables().between[from][to]&(bb.color[WHITE]|bb.color[BLACK]));
+    }
+
+    int kingSquare(Color c) const {
+        uint64_t k=bb.pieces[c][KING];
+        return k?lsb(k):-1;
+    }
+
+    uint64_t occupancy(Color c) const { return bb.color[c]; }
+
+    template<class F> void forEach(Color c,F f) const {
+        for (uint64_t b=bb.color[c];b;b&=b-1) f(lsb(b));
+    }
+
+    const Bitboards& bitboards() const { return bb; }
+};
+
+// King squares for the mailbox backends, which have no piece lists.
+struct KingTracker {
+    int king[3]={-1,-1,-1};
+
+    void update(int sq,Piece old,Piece p) {
+        if (old.type==KING && king[old.color]==sq) king[old.color]=-1;
+        if (p.type==KING) king[p.color]=sq;
+    }
+};
+
+// ---------- 8x8 mailbox ----------
+// Plain array; attacks walk the board with bounds checks.
+class Mailbox8x8Board {
+private:
+    Piece squares[8][8];
+    KingTracker kings;
+
+    bool holds(int r,int c,Color by,PieceType t) const {
+        return r>=0 && r<8 && c>=0 && c<8 && squares[r][c].color==by && squares[r][c].type==t;
+    }
+
+public:
+    static const char* name() { return "mailbox8x8"; }
+
+    Mailbox8x8Board() { clear(); }
+
+    void clear() {
+        for (auto& row:squares) for (auto& p:row) p=Piece();
+        kings=KingTracker();
+    }
+
+    Piece at(int r,int c) const { return squares[r][c]; }
+
+    void set(int r,int c,Piece p) {
+        kings.update(r*8+c,squares[r][c],p);
+        squares[r][c]=p;
+    }
+
+    bool attacked(int sq,Color by) const {
+        static const int KN[8][2]={{-2,-1},{-2,1},{-1,-2},{-1,2},{1,-2},{1,2},{2,-1},{2,1}};
+        int r=sq/8, c=sq%8;
+        int pr=by==WHITE?r+1:r-1;               // row the attacking pawn stands on
+        if (holds(pr,c-1,by,PAWN) || holds(pr,c+1,by,PAWN)) return true;
+        for (auto& d:KN) if (holds(r+d[0],c+d[1],by,KNIGHT)) return true;
+        for (int dr=-1;dr<=1;dr++)
+            for (int dc=-1;dc<=1;dc++)
+                if ((dr||dc) && holds(r+dr,c+dc,by,KING)) return true;
+        for (int d=0;d<8;d++) {
+            PieceType slider=d&1?BISHOP:ROOK;
+            for (int tr=r+RAY_DR[d],tc=c+RAY_DC[d];tr>=0 && tr<8 && tc>=0 && tc<8;tr+=RAY_DR[d],tc+=RAY_DC[d]) {
+                const Piece& p=squares[tr][tc];
+                if (p.type==EMPTY) continue;
+                if (p.color==by && (p.type==slider || p.type==QUEEN)) return true;
+                break;
+            }
+        }
+        return false;
+    }
+
+    bool pathClear(int from,int to) const {
+        int fr=from/8, fc=from%8, tr=to/8, tc=to%8;
+        int sr=(tr>fr)-(tr<fr), sc=(tc>fc)-(tc<fc);
+        for (int r=fr+sr,c=fc+sc;r!=tr || c!=tc;r+=sr,c+=sc)
+            if (squares[r][c].type!=EMPTY) return false;
+        return true;
+    }
+
+    int kingSquare(Color c) const { return kings.king[c]; }
+
+    uint64_t occupancy(Color c) const {
+        uint64_t b=0;
+        for (int sq=0;sq<64;sq++)
+            if (squares[sq/8][sq%8].color==c) b|=1ULL<<sq;
+        return b;
+    }
+
+    template<class F> void forEach(Color c,F f) const {
+        for (int sq=0;sq<64;sq++)
+            if (squares[sq/8][sq%8].color==c) f(sq);
+    }
+};
+
+// ---------- 10x12 mailbox ----------
+// 8x8 board inside a border two rows deep at top and bottom and one column
+// wide at the sides, so knight jumps and ray walks stop on a border cell
+// instead of testing coordinates.
+struct Mailbox120Layout {
+    int8_t to64[120]{};         // -1 on the border
+    int8_t to120[64]{};
+
+    constexpr Mailbox120Layout() {
+        for (int i=0;i<120;i++) to64[i]=-1;
+        for (int sq=0;sq<64;sq++) {
+            to120[sq]=int8_t((sq/8+2)*10+sq%8+1);
+            to64[to120[sq]]=int8_t(sq);
+        }
+    }
+};
+
+inline constexpr Mailbox120Layout MAILBOX120{};
+
+class Mailbox10x12Board {
+private:
+    // Step of each RAY_DR/RAY_DC direction
+    static constexpr int RAY_STEP[8]={1,11,10,9, -1,-11,-10,-9};
+    static constexpr int KNIGHT_STEP[8]={-21,-19,-12,-8,8,12,19,21};
+    static constexpr int KING_STEP[8]={-11,-10,-9,-1,1,9,10,11};
+
+    Piece cells[120];
+    KingTracker kings;
+
+    bool holds(int i,Color by,PieceType t) const {
+        return MAILBOX120.to64[i]>=0 && cells[i].color==by && cells[i].type==t;
+    }
+
+public:
+    static const char* name() { return "mailbox10x12"; }
+
+    Mailbox10x12Board() { clear(); }
+
+    void clear() {
+        for (auto& p:cells) p=Piece();
+        kings=KingTracker();
+    }
+
+    Piece at(int r,int c) const { return cells[MAILBOX120.to120[r*8+c]]; }
+
+    void set(int r,int c,Piece p) {
+        Piece& cell=cells[MAILBOX120.to120[r*8+c]];
+        kings.update(r*8+c,cell,p);
+        cell=p;
+    }
+
+    bool attacked(int sq,Color by) const {
+        int i=MAILBOX120.to120[sq];
+        int pawnFrom=by==WHITE?10:-10;          // attacking pawn stands one row further from its goal
+        if (holds(i+pawnFrom-1,by,PAWN) || holds(i+pawnFrom+1,by,PAWN)) return true;
+        for (int s:KNIGHT_STEP) if (holds(i+s,by,KNIGHT)) return true;
+        for (int s:KING_STEP) if (holds(i+s,by,KING)) return true;
+        for (int d=0;d<8;d++) {
+            PieceType slider=d&1?BISHOP:ROOK;
+            for (int j=i+RAY_STEP[d];MAILBOX120.to64[j]>=0;j+=RAY_STEP[d]) {
+                const Piece& p=cells[j];
+                if (p.type==EMPTY) continue;
+                if (p.color==by && (p.type==slider || p.type==QUEEN)) return true;
+                break;
+            }
+        }
+        return false;
+    }
+
+    bool pathClear(int from,int to) const {
+        int fr=from/8, fc=from%8, tr=to/8, tc=to%8;
+        int step=((tr>fr)-(tr<fr))*10+(tc>fc)-(tc<fc);
+        int end=MAILBOX120.to120[to];
+        for (int j=MAILBOX120.to120[from]+step;j!=end;j+=step)
+            if (cells[j].type!=EMPTY) return false;
+        return true;
+    }
+
+    int kingSquare(Color c) const { return kings.king[c]; }
+
+    uint64_t occupancy(Color c) const {
+        uint64_t b=0;
+        for (int sq=0;sq<64;sq++)
+            if (cells[MAILBOX120.to120[sq]].color==c) b|=1ULL<<sq;
+        return b;
+    }
+
+    template<class F> void forEach(Color c,F f) const {
+        for (int sq=0;sq<64;sq++)
+            if (cells[MAILBOX120.to120[sq]].color==c) f(sq);
+    }
+};
+
+#endif // CHESS_BOARD_H
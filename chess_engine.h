@@ -0,0 +1,1074 @@
+#ifndef CHESS_ENGINE_H
+#define CHESS_ENGINE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+
+#include "chess_board.h"
+#include "chess_stats.h"
+#include "chess_memory.h"
+#include "chess_arena.h"
+
+using namespace std;
+
+// Per-side constants for code templated on the side to move; rows as on the
+// board (row 0 = rank 8).
+template<Color Us> struct Side {
+    static constexpr Color THEM=Us==WHITE?BLACK:WHITE;
+    static constexpr int PAWN_DIR=Us==WHITE?-1:1;      // row step of a pawn push
+    static constexpr int PROMOTION_ROW=Us==WHITE?0:7;
+    static constexpr int EP_TARGET_ROW=Us==WHITE?2:5;  // where an en passant capture lands
+};
+
+// ================= MOVE =================
+struct Move {
+    int fromRow, fromCol, toRow, toCol;
+    PieceType promotion;
+    bool isEnPassant, isCastling;
+    Move() : fromRow(0), fromCol(0), toRow(0), toCol(0),
+             promotion(EMPTY), isEnPassant(false), isCastling(false) {}
+};
+
+// from square (6 bits) | to square (6 bits) | promotion piece type (3 bits),
+// squares numbered row*8+col. Castling/en passant flags are not kept; match
+// the packed value against the legal list to recover them.
+inline uint16_t packMove(const Move& m) {
+    return uint16_t((m.fromRow*8+m.fromCol) |
+                    ((m.toRow*8+m.toCol)<<6) |
+                    (int(m.promotion)<<12));
+}
+
+inline Move unpackMove(uint16_t v) {
+    Move m;
+    m.fromRow=(v&63)/8;      m.fromCol=(v&63)%8;
+    m.toRow=((v>>6)&63)/8;   m.toCol=((v>>6)&63)%8;
+    m.promotion=PieceType((v>>12)&7);
+    return m;
+}
+
+// ================= PACKED PLACEMENT =================
+// Piece placement as a bit per occupied square plus a 4-bit code per occupied
+// square in square order (type | 8 for black): 24 bytes for up to 32 pieces.
+// Shared by Checkpoint and the self-play PackedPosition records.
+template<class F> inline void packPlacement(F pieceAt,uint64_t& occupancy,uint8_t pieces[16]) {
+    occupancy=0;
+    memset(pieces,0,16);
+    int n=0;
+    for (int sq=0;sq<64 && n<32;sq++) {
+        Piece p=pieceAt(sq);
+        if (p.type==EMPTY) continue;
+        occupancy|=1ULL<<sq;
+        pieces[n/2]|=uint8_t((p.type|(p.color==BLACK?8:0))<<((n&1)*4));
+        n++;
+    }
+}
+
+// Calls f(sq, piece) for every occupied square, in square order.
+template<class F> inline void unpackPlacement(uint64_t occupancy,const uint8_t pieces[16],F f) {
+    int n=0;
+    for (uint64_t occ=occupancy;occ;occ&=occ-1,n++) {
+        int code=(pieces[n/2]>>((n&1)*4))&15;
+        f(lsb(occ),Piece(PieceType(code&7),code&8?BLACK:WHITE));
+    }
+}
+
+// ================= CHECKPOINT =================
+// Compact full position kept on every CHECKPOINT_INTERVAL-th node of the game
+// tree. hasMoved is stored as is: deriving it from the castling rights would
+// be wrong once the game is stepped back past the restored position.
+struct Checkpoint {
+    uint64_t occupancy;         // bit per occupied square
+    uint64_t moved;             // bit per piece with hasMoved set
+    uint8_t pieces[16];         // packPlacement() codes
+    uint8_t side;
+    int8_t epCol, epRow;
+    int32_t halfMoveClock;
+};
+static_assert(sizeof(Checkpoint)==40,"Checkpoint must stay 40 bytes");
+
+static const int CHECKPOINT_INTERVAL=8;
+
+static const char* const START_FEN="rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// ================= ZOBRIST KEYS =================
+// 64-bit position hashing; squares are numbered row*8+col (row 0 = rank 8).
+struct ZobristKeys {
+    uint64_t piece[3][7][64]{}; // [color][type][square]
+    uint64_t side=0;
+    uint64_t castling[16]{};
+    uint64_t enPassant[8]{};
+
+    // splitmix64; the sequence is fixed because explorer indexes store these
+    // hashes.
+    static constexpr uint64_t next(uint64_t& s) {
+        uint64_t z=(s+=0x9E3779B97F4A7C15ULL);
+        z=(z^(z>>30))*0xBF58476D1CE4E5B9ULL;
+        z=(z^(z>>27))*0x94D049BB133111EBULL;
+        return z^(z>>31);
+    }
+
+    constexpr ZobristKeys() {
+        uint64_t s=0x9E3779B97F4A7C15ULL;
+        for (auto& c:piece) for (auto& t:c) for (auto& k:t) k=next(s);
+        side=next(s);
+        for (auto& k:castling) k=next(s);
+        for (auto& k:enPassant) k=next(s);
+    }
+};
+
+inline constexpr ZobristKeys ZOBRIST{};
+
+inline const ZobristKeys& zobrist() { return ZOBRIST; }
+
+// ================= GAME =================
+// Rules, game tree and I/O over a board backend (chess_board.h). The engine
+// uses ChessGame, the bitboard instantiation; the others exist to compare
+// representations (backend_bench).
+template<class Board>
+class BasicChessGame {
+private:
+    Board board;
+    Color currentPlayer;
+    int enPassantCol, enPassantRow;
+    int halfMoveClock;
+
+public:
+    struct VariationNode;
+
+private:
+    // Everything a game accumulates while being played lives in here, so a
+    // session costs its pool slot plus a few arena blocks.
+    Arena arena;
+
+    // Game tree rooted at the loaded position; cursor is the node whose
+    // position is on the board.
+    VariationNode* root;
+    VariationNode* cursor;
+    MemoryAccount treeMem{MEM_TREE};     // STATS MEMORY
+
+    VariationNode* newNode(VariationNode* parent) {
+        VariationNode* n=new (arena.allocate(sizeof(VariationNode),alignof(VariationNode))) VariationNode();
+        n->parent=parent;
+        n->ply=parent?parent->ply+1:0;
+        treeMem.add(sizeof(VariationNode));
+        return n;
+    }
+
+    void addCheckpoint(VariationNode* n) {
+        n->checkpoint=new (arena.allocate(sizeof(Checkpoint),alignof(Checkpoint))) Checkpoint;
+        saveCheckpoint(*n->checkpoint);
+        treeMem.add(sizeof(Checkpoint));
+    }
+
+    // A fresh tree holding only the current position.
+    void resetTree() {
+        arena.reset();
+        treeMem.set(0);
+        root=cursor=newNode(nullptr);
+        root->hash=repetitionKey();
+        addCheckpoint(root);
+    }
+
+public:
+    BasicChessGame() {
+        currentPlayer = WHITE;
+        enPassantCol = enPassantRow = -1;
+        halfMoveClock = 0;
+        setupBoard();
+        resetTree();
+    }
+
+    BasicChessGame(const BasicChessGame&) = delete;
+    BasicChessGame& operator=(const BasicChessGame&) = delete;
+
+    // Heap-allocated games come from the session pool.
+    static void* operator new(size_t n) {
+        typedef SlabPool<sizeof(BasicChessGame),MEM_SESSIONS> SessionPool;
+        return n==sizeof(BasicChessGame) ? SessionPool::instance().allocate() : ::operator new(n);
+    }
+
+    static void operator delete(void* p,size_t n) {
+        typedef SlabPool<sizeof(BasicChessGame),MEM_SESSIONS> SessionPool;
+        if (n==sizeof(BasicChessGame)) SessionPool::instance().deallocate(p);
+        else ::operator delete(p);
+    }
+
+    // ---------- SETUP ----------
+    void setupBoard() {
+        board.clear();
+
+        PieceType back[] = {ROOK,KNIGHT,BISHOP,QUEEN,KING,BISHOP,KNIGHT,ROOK};
+        for (int i = 0; i < 8; i++) {
+            board.set(0, i, Piece(back[i], BLACK));
+            board.set(1, i, Piece(PAWN, BLACK));
+            board.set(6, i, Piece(PAWN, WHITE));
+            board.set(7, i, Piece(back[i], WHITE));
+        }
+    }
+
+    // Load a FEN (the move counters are optional, as in EPD). Castling rights
+    // are mapped onto hasMoved. Starts a new game tree. More than 32 pieces,
+    // a second king of one colour or a pawn on the first or last rank is
+    // rejected.
+    bool loadFen(const string& fen) {
+        istringstream ss(fen);
+        string placement, side, castling="-", ep="-";
+        int halfMoves=0;
+        if (!(ss>>placement>>side)) return false;
+        ss>>castling>>ep>>halfMoves;
+
+        Piece nb[8][8];
+        int r=0, c=0;
+        int pieces=0, kings[3]={0,0,0};
+        for (char ch:placement) {
+            if (ch=='/') { r++; c=0; continue; }
+            if (isdigit((unsigned char)ch)) { c+=ch-'0'; continue; }
+            if (r>7 || c>7) return false;
+            PieceType t=pieceFromChar(ch);
+            if (t==EMPTY) return false;
+            nb[r][c]=Piece(t,isupper((unsigned char)ch)?WHITE:BLACK);
+            // a Checkpoint packs at most 32 pieces
+            if (++pieces>32 || (t==KING && ++kings[nb[r][c].color]>1)) return false;
+            // the move generator assumes a pawn always has a square ahead
+            if (t==PAWN && (r==0 || r==7)) return false;
+            // pawns off their start rank can no longer double-push
+            if (t==PAWN && r!=(nb[r][c].color==WHITE?6:1))
+                nb[r][c].hasMoved=true;
+            c++;
+        }
+        if (r!=7 || (side!="w" && side!="b")) return false;
+
+        for (int s=0;s<2;s++) {
+            int kr=s==0?7:0;
+            char kSide=s==0?'K':'k', qSide=s==0?'Q':'q';
+            bool kRight=castling.find(kSide)!=string::npos;
+            bool qRight=castling.find(qSide)!=string::npos;
+            if (nb[kr][4].type==KING && !kRight && !qRight) nb[kr][4].hasMoved=true;
+            if (nb[kr][7].type==ROOK && !kRight) nb[kr][7].hasMoved=true;
+            if (nb[kr][0].type==ROOK && !qRight) nb[kr][0].hasMoved=true;
+        }
+
+        board.clear();
+        for (int i=0;i<8;i++)
+            for (int j=0;j<8;j++)
+                if (nb[i][j].type!=EMPTY) board.set(i,j,nb[i][j]);
+        currentPlayer=side=="w"?WHITE:BLACK;
+        enPassantCol=enPassantRow=-1;
+        if (ep.size()==2 && ep[0]>='a' && ep[0]<='h') {
+            enPassantCol=ep[0]-'a';
+            enPassantRow=ep[1]=='3'?4:3;   // row of the pawn that just moved
+        }
+        halfMoveClock=halfMoves;
+
+        resetTree();
+        return true;
+    }
+
+    // ---------- HELPERS ----------
+    char getPieceChar(Piece p) {
+        if (p.type == EMPTY) return '.';
+        char map[] = {' ', 'P','N','B','R','Q','K'};
+        char ch = map[p.type];
+        return p.color == BLACK ? tolower(ch) : ch;
+    }
+
+    // displayBoard function was here
+
+    Color sideToMove() { return currentPlayer; }
+    Piece pieceAt(int r,int c) { return board.at(r,c); }
+    const Bitboards& bitboards() const { return board.bitboards(); }   // bitboard backend only
+    int halfMoves() { return halfMoveClock; }
+    int enPassantFile() { return enPassantCol; }
+    Color opponent(Color c) { return c == WHITE ? BLACK : WHITE; }
+    bool isValid(int r,int c) { return r>=0 && r<8 && c>=0 && c<8; }
+
+    void findKing(Color c,int &kr,int &kc) {
+        int sq=board.kingSquare(c);
+        if (sq<0) { kr=kc=0; return; }
+        kr=sq/8; kc=sq%8;
+    }
+
+    // UCI text of a move, e.g. "e2e4" or "e7e8q"
+    string moveToString(const Move& m) {
+        string s;
+        s+=char('a'+m.fromCol); s+=char('0'+8-m.fromRow);
+        s+=char('a'+m.toCol);   s+=char('0'+8-m.toRow);
+        if (m.promotion!=EMPTY)
+            s+=char(tolower(getPieceChar(Piece(m.promotion,WHITE))));
+        return s;
+    }
+
+    // printMoveHistoryReport function was here
+
+    // ---------- ATTACK CHECK ----------
+    bool isSquareAttacked(int tr,int tc,Color by) {
+        STAT_INC(STAT_ATTACKS);
+        return board.attacked(tr*8+tc,by);
+    }
+
+    bool isInCheck(Color c) {
+        int kr,kc;
+        findKing(c,kr,kc);
+        return isSquareAttacked(kr,kc,opponent(c));
+    }
+
+    // ---------- MOVE LOGIC ----------
+    // Side-specific code is templated on the mover's colour; the public
+    // entry points pick the instantiation once per call.
+    bool canPieceMoveTo(int fr,int fc,int tr,int tc,bool ignoreCheck) {
+        switch (board.at(fr,fc).color) {
+            case WHITE: return canPieceMoveTo<WHITE>(fr,fc,tr,tc,ignoreCheck);
+            case BLACK: return canPieceMoveTo<BLACK>(fr,fc,tr,tc,ignoreCheck);
+            default: return false;
+        }
+    }
+
+    // The piece on (fr,fc) must be Us.
+    template<Color Us>
+    bool canPieceMoveTo(int fr,int fc,int tr,int tc,bool ignoreCheck) {
+        typedef Side<Us> S;
+        Piece p=board.at(fr,fc);
+        if (board.at(tr,tc).color==Us) return false;
+
+        int dr=tr-fr, dc=tc-fc;
+
+        if (p.type==PAWN) {
+            if (dc==0 && dr==S::PAWN_DIR && board.at(tr,tc).type==EMPTY) return true;
+            if (dc==0 && dr==2*S::PAWN_DIR && !p.hasMoved &&
+                board.at(fr+S::PAWN_DIR,fc).type==EMPTY &&
+                board.at(tr,tc).type==EMPTY) return true;
+            if (abs(dc)==1 && dr==S::PAWN_DIR) {
+                if (board.at(tr,tc).type!=EMPTY) return true;
+                if (tc==enPassantCol && tr==S::EP_TARGET_ROW) return true;
+            }
+            return false;
+        }
+
+        int from=fr*8+fc, to=tr*8+tc;
+        const LineTables& lt=lineTables();
+
+        if (p.type==KNIGHT)
+            return attackTables().knight[from]>>to&1;
+
+        if (p.type==KING) {
+            if (lt.distance[from][to]==1) return true;
+            if (!ignoreCheck && dr==0 && abs(dc)==2 && !p.hasMoved) {
+                int rookCol = dc>0?7:0;
+                int step = dc>0?1:-1;
+                if (board.at(fr,rookCol).type==ROOK &&
+                    !board.at(fr,rookCol).hasMoved) {
+                    if (!board.pathClear(from,fr*8+rookCol)) return false;
+                    if (!isSquareAttacked(fr,fc,S::THEM) &&
+                        !isSquareAttacked(fr,fc+step,S::THEM) &&
+                        !isSquareAttacked(tr,tc,S::THEM))
+                        return true;
+                }
+            }
+            return false;
+        }
+
+        bool diag=abs(dr)==abs(dc);
+        bool straight=dr==0||dc==0;
+        if (p.type==BISHOP && !diag) return false;
+        if (p.type==ROOK && !straight) return false;
+        if (p.type==QUEEN && !(diag||straight)) return false;
+
+        return board.pathClear(from,to);
+    }
+
+    // Makes the whole move (en passant victim and castling rook included)
+    // and checks the mover's king.
+    bool testMove(const Move& m) {
+        switch (board.at(m.fromRow,m.fromCol).color) {
+            case WHITE: return testMove<WHITE>(m);
+            case BLACK: return testMove<BLACK>(m);
+            default: return false;
+        }
+    }
+
+    template<Color Us>
+    bool testMove(const Move& m) {
+        STAT_INC(STAT_LEGALITY);
+        UndoInfo u;
+        applyMove<Us>(m,u);
+        int kr,kc;
+        findKing(Us,kr,kc);
+        bool ok=!isSquareAttacked(kr,kc,Side<Us>::THEM);
+        unapplyMove<Us>(m,u);
+        return ok;
+    }
+
+    // ---------- SINGLE-MOVE LEGALITY ----------
+    // Castling and en passant flags as getLegalMoves() sets them for the
+    // move's squares; the promotion piece is left as given.
+    void fillMoveFlags(Move& m) {
+        Piece p=board.at(m.fromRow,m.fromCol);
+        m.isCastling=p.type==KING && m.toRow==m.fromRow && abs(m.toCol-m.fromCol)==2;
+        m.isEnPassant=p.type==PAWN && m.toCol!=m.fromCol && board.at(m.toRow,m.toCol).type==EMPTY;
+    }
+
+    // m follows the movement rules for the side to move, flags and promotion
+    // included, but may leave its own king in check. Castling out of or
+    // through check is already rejected here.
+    bool isPseudoLegal(const Move& m) {
+        if (!isValid(m.fromRow,m.fromCol) || !isValid(m.toRow,m.toCol)) return false;
+        Piece p=board.at(m.fromRow,m.fromCol);
+        if (p.color!=currentPlayer) return false;
+        Move f=m;
+        fillMoveFlags(f);
+        if (f.isCastling!=m.isCastling || f.isEnPassant!=m.isEnPassant) return false;
+        bool promotes=p.type==PAWN && m.toRow==(currentPlayer==WHITE?0:7);
+        if (promotes?(m.promotion<KNIGHT || m.promotion>QUEEN):m.promotion!=EMPTY) return false;
+        return currentPlayer==WHITE?canPieceMoveTo<WHITE>(m.fromRow,m.fromCol,m.toRow,m.toCol,false)
+                                   :canPieceMoveTo<BLACK>(m.fromRow,m.fromCol,m.toRow,m.toCol,false);
+    }
+
+    // Same answer as looking m up in getLegalMoves(sideToMove()), without
+    // generating anything.
+    bool isLegal(const Move& m) {
+        if (!isPseudoLegal(m)) return false;
+        return currentPlayer==WHITE?keepsKingSafe<WHITE>(m):keepsKingSafe<BLACK>(m);
+    }
+
+    // A packed move (transposition table) back to a full move, if legal here.
+    bool unpackLegal(uint16_t v,Move& m) {
+        m=unpackMove(v);
+        fillMoveFlags(m);
+        return isLegal(m);
+    }
+
+    // For a pseudo-legal m. Out of check, a piece can only expose its king if
+    // it stands on a line from the king with nothing in between and leaves
+    // that line; everything else needs no trial move. King moves, en passant
+    // (two pieces leave the rank) and evasions are made and tested.
+    template<Color Us>
+    bool keepsKingSafe(const Move& m) {
+        int k=board.kingSquare(Us);
+        int from=m.fromRow*8+m.fromCol, to=m.toRow*8+m.toCol;
+        if (k<0 || k==from || m.isEnPassant || isSquareAttacked(k/8,k%8,Side<Us>::THEM))
+            return testMove<Us>(m);
+        uint64_t line=lineTables().line[k][from];
+        if (!line || line>>to&1 || !board.pathClear(k,from)) return true;
+        return testMove<Us>(m);
+    }
+
+    // ---------- GIVES CHECK ----------
+    // Per position, for the side to move: the squares from which each piece
+    // type would attack the enemy king, and the own pieces that are the only
+    // thing between that king and an own slider (moving one off the line
+    // discovers check).
+    struct CheckInfo {
+        int king;                   // enemy king square, -1 without one
+        uint64_t squares[7];        // by PieceType
+        uint64_t discoverers;
+    };
+
+    CheckInfo checkInfo() {
+        Color us=currentPlayer, them=opponent(us);
+        CheckInfo ci;
+        memset(&ci,0,sizeof(ci));
+        ci.king=board.kingSquare(them);
+        if (ci.king<0) return ci;
+        const AttackTables& at=attackTables();
+        ci.squares[PAWN]=at.pawn[them][ci.king];        // a pawn there attacks the king
+        ci.squares[KNIGHT]=at.knight[ci.king];
+        int kr=ci.king/8, kc=ci.king%8;
+        for (int d=0;d<8;d++) {
+            PieceType slider=d&1?BISHOP:ROOK;
+            int blocker=-1;
+            for (int r=kr+RAY_DR[d],c=kc+RAY_DC[d];isValid(r,c);r+=RAY_DR[d],c+=RAY_DC[d]) {
+                Piece p=board.at(r,c);
+                if (blocker<0) ci.squares[slider]|=1ULL<<(r*8+c);
+                if (p.type==EMPTY) continue;
+                if (blocker>=0) {
+                    if (p.color==us && (p.type==slider || p.type==QUEEN)) ci.discoverers|=1ULL<<blocker;
+                    break;
+                }
+                if (p.color!=us) break;
+                blocker=r*8+c;
+            }
+        }
+        ci.squares[QUEEN]=ci.squares[ROOK]|ci.squares[BISHOP];
+        return ci;
+    }
+
+    // Whether the legal move m checks the enemy king, without making it.
+    // Castling and en passant, where a second piece moves, are made and tested.
+    bool givesCheck(const Move& m,const CheckInfo& ci) {
+        if (ci.king<0) return false;
+        if (m.isCastling || m.isEnPassant) {
+            UndoInfo u;
+            applyMove(m,u);
+            bool check=isInCheck(currentPlayer);
+            unapplyMove(m,u);
+            return check;
+        }
+        int from=m.fromRow*8+m.fromCol, to=m.toRow*8+m.toCol;
+        PieceType t=m.promotion!=EMPTY?m.promotion:board.at(m.fromRow,m.fromCol).type;
+        if (ci.squares[t]>>to&1) return true;
+        const LineTables& lt=lineTables();
+        if (ci.discoverers>>from&1 && !(lt.line[ci.king][from]>>to&1)) return true;
+        // a slider (or promotion) retreating along a line the vacated square blocked
+        if (t>=BISHOP && t<=QUEEN && lt.between[to][ci.king]>>from&1) {
+            bool diag=to/8-ci.king/8!=0 && to%8-ci.king%8!=0;
+            if (t==(diag?ROOK:BISHOP)) return false;
+            return board.pathClear(to,from) && board.pathClear(from,ci.king);
+        }
+        return false;
+    }
+
+    bool givesCheck(const Move& m) { return givesCheck(m,checkInfo()); }
+
+    vector<Move> getLegalMoves(Color c) {
+        STAT_INC(STAT_MOVEGEN);
+        vector<Move> moves;
+        if (c==WHITE) generateLegal<WHITE>(moves);
+        else if (c==BLACK) generateLegal<BLACK>(moves);
+        return moves;
+    }
+
+    // Origins in square order, as the board scan did, so move order (and
+    // with it search behaviour) is unchanged.
+    template<Color Us>
+    void generateLegal(vector<Move>& moves) {
+        board.forEach(Us,[&](int sq) {
+            int r=sq/8, col=sq%8;
+            for (int tr=0;tr<8;tr++)
+                for (int tc=0;tc<8;tc++)
+                    if (canPieceMoveTo<Us>(r,col,tr,tc,false)) {
+                        Move m;
+                        m.fromRow=r; m.fromCol=col;
+                        m.toRow=tr;  m.toCol=tc;
+                        if (board.at(r,col).type==KING && abs(tc-col)==2)
+                            m.isCastling=true;
+                        if (board.at(r,col).type==PAWN &&
+                            board.at(tr,tc).type==EMPTY && tc!=col)
+                            m.isEnPassant=true;
+                        if (!testMove<Us>(m)) continue;
+                        if (board.at(r,col).type==PAWN && tr==Side<Us>::PROMOTION_ROW) {
+                            PieceType ps[]={QUEEN,ROOK,BISHOP,KNIGHT};
+                            for (auto p:ps){Move pm=m;pm.promotion=p;moves.push_back(pm);}
+                        } else moves.push_back(m);
+                    }
+        });
+    }
+
+    // ---------- MOVE COUNTING ----------
+    // Number of moves getLegalMoves(sideToMove()) would return, without
+    // building the list: target masks per piece, cut down by check and pin
+    // masks, are popcounted. Only king moves, castling and en passant are
+    // made and tested one by one.
+    int countLegalMoves() {
+        return currentPlayer==WHITE?countLegal<WHITE>(false):countLegal<BLACK>(false);
+    }
+
+    // Stops at the first legal move found.
+    bool hasLegalMove() {
+        return (currentPlayer==WHITE?countLegal<WHITE>(true):countLegal<BLACK>(true))>0;
+    }
+
+    // Enemy pieces giving check to Us, and Us pieces pinned to their king.
+    struct KingSafety {
+        int king;
+        uint64_t checkers, pinned;
+    };
+
+    template<Color Us>
+    KingSafety kingSafety() {
+        const Color Them=Side<Us>::THEM;
+        KingSafety ks{board.kingSquare(Us),0,0};
+        if (ks.king<0) return ks;
+        const AttackTables& at=attackTables();
+        auto holds=[&](int sq,PieceType t) {
+            Piece p=board.at(sq/8,sq%8);
+            return p.color==Them && p.type==t;
+        };
+        for (uint64_t b=at.pawn[Us][ks.king];b;b&=b-1)
+            if (holds(lsb(b),PAWN)) ks.checkers|=b&-b;
+        for (uint64_t b=at.knight[ks.king];b;b&=b-1)
+            if (holds(lsb(b),KNIGHT)) ks.checkers|=b&-b;
+        int kr=ks.king/8, kc=ks.king%8;
+        for (int d=0;d<8;d++) {
+            PieceType slider=d&1?BISHOP:ROOK;
+            int shield=-1;
+            for (int r=kr+RAY_DR[d],c=kc+RAY_DC[d];isValid(r,c);r+=RAY_DR[d],c+=RAY_DC[d]) {
+                Piece p=board.at(r,c);
+                if (p.type==EMPTY) continue;
+                bool hits=p.color==Them && (p.type==slider || p.type==QUEEN);
+                if (shield>=0) {
+                    if (hits) ks.pinned|=1ULL<<shield;
+                    break;
+                }
+                if (hits) ks.checkers|=1ULL<<(r*8+c);
+                if (p.color!=Us) break;
+                shield=r*8+c;
+            }
+        }
+        return ks;
+    }
+
+    template<Color Us>
+    int countLegal(bool firstOnly) {
+        typedef Side<Us> S;
+        KingSafety ks=kingSafety<Us>();
+        if (ks.king<0) {                    // kingless test positions
+            vector<Move> moves;
+            generateLegal<Us>(moves);
+            return (int)moves.size();
+        }
+        const AttackTables& at=attackTables();
+        const LineTables& lt=lineTables();
+        const uint64_t own=board.occupancy(Us), enemy=board.occupancy(S::THEM), all=own|enemy;
+        const uint64_t promotionRow=0xFFULL<<(S::PROMOTION_ROW*8);
+        // squares a non-king move must land on: anywhere, the checker or
+        // the line to it, nowhere in double check
+        uint64_t evasion=~0ULL;
+        if (ks.checkers) {
+            evasion=ks.checkers&(ks.checkers-1)?0:
+                    ks.checkers|lt.between[ks.king][lsb(ks.checkers)];
+        }
+        int n=0;
+        auto tryMove=[&](int from,int to) {
+            Move m;
+            m.fromRow=from/8; m.fromCol=from%8;
+            m.toRow=to/8;     m.toCol=to%8;
+            fillMoveFlags(m);
+            if (testMove<Us>(m)) n++;
+        };
+        board.forEach(Us,[&](int sq) {
+            if (firstOnly && n) return;
+            Piece p=board.at(sq/8,sq%8);
+            int r=sq/8, c=sq%8;
+            uint64_t targets=0;
+            if (p.type==KING) {
+                // the king leaves its square, so x-rays matter: make each move
+                for (uint64_t b=at.king[sq]&~own;b;b&=b-1) tryMove(sq,lsb(b));
+                if (!p.hasMoved && !ks.checkers)
+                    for (int dc=-2;dc<=2;dc+=4)
+                        if (isValid(r,c+dc) && canPieceMoveTo<Us>(r,c,r,c+dc,false)) tryMove(sq,sq+dc);
+                return;
+            }
+            if (p.type==PAWN) {
+                int fwd=sq+8*S::PAWN_DIR;
+                if (!(all>>fwd&1)) {
+                    targets|=1ULL<<fwd;
+                    int fwd2=fwd+8*S::PAWN_DIR;
+                    if (!p.hasMoved && fwd2>=0 && fwd2<64 && !(all>>fwd2&1)) targets|=1ULL<<fwd2;
+                }
+                targets|=at.pawn[Us][sq]&enemy;
+                int ep=S::EP_TARGET_ROW*8+enPassantCol;
+                if (enPassantCol>=0 && r==S::EP_TARGET_ROW-S::PAWN_DIR && abs(c-enPassantCol)==1 &&
+                    !(all>>ep&1)) tryMove(sq,ep);
+            } else if (p.type==KNIGHT) {
+                targets=at.knight[sq];
+            } else {
+                for (int d=0;d<8;d++) {
+                    if (p.type==(d&1?ROOK:BISHOP)) continue;
+                    uint64_t ray=at.ray[d][sq], blockers=ray&all;
+                    if (blockers) ray&=~at.ray[d][d<4?lsb(blockers):msb(blockers)];
+                    targets|=ray;
+                }
+            }
+            targets&=~own&evasion;
+            if (ks.pinned>>sq&1) targets&=lt.line[ks.king][sq];
+            if (p.type==PAWN) n+=3*popcount(targets&promotionRow);
+            n+=popcount(targets);
+        });
+        return n;
+    }
+
+    // ---------- PERFT ----------
+    // Leaf count of the legal move tree `depth` plies deep. With bulk the
+    // last ply is counted with countLegalMoves() without being generated or
+    // made; without it every leaf comes from getLegalMoves(), which is how
+    // perft_suite checks the generator itself.
+    uint64_t perft(int depth,bool bulk=true) {
+        if (depth==0) return 1;
+        if (depth==1 && bulk) return countLegalMoves();
+        vector<Move> moves=getLegalMoves(currentPlayer);
+        uint64_t n=0;
+        for (auto& m:moves) {
+            UndoInfo u;
+            applyMove(m,u);
+            n+=perft(depth-1,bulk);
+            unapplyMove(m,u);
+        }
+        return n;
+    }
+
+    // ---------- STATUS ----------
+    // Times the current position occurred on the path from the root, counting
+    // the current one. Only positions since the last capture or pawn move can
+    // match, and castling and en passant rights take part via the hash.
+    int repetitionCount() {
+        uint64_t h=repetitionKey();
+        int n=1;
+        const VariationNode* v=cursor;
+        for (int i=0;i<halfMoveClock && v->parent;i++) {
+            v=v->parent;
+            n+=v->hash==h;
+        }
+        return n;
+    }
+
+    // Castling rights derived from hasMoved: bit0 white O-O, bit1 white O-O-O,
+    // bit2 black O-O, bit3 black O-O-O.
+    int castlingRights() {
+        int rights=0;
+        for (int side=0;side<2;side++) {
+            Color c=side==0?WHITE:BLACK;
+            int r=side==0?7:0;
+            Piece k=board.at(r,4);
+            if (k.type!=KING || k.color!=c || k.hasMoved) continue;
+            Piece hr=board.at(r,7), ar=board.at(r,0);
+            if (hr.type==ROOK && hr.color==c && !hr.hasMoved) rights|=1<<(side*2);
+            if (ar.type==ROOK && ar.color==c && !ar.hasMoved) rights|=2<<(side*2);
+        }
+        return rights;
+    }
+
+    uint64_t positionHash() {
+        const ZobristKeys& z=zobrist();
+        uint64_t h=0;
+        for (int r=0;r<8;r++)
+            for (int c=0;c<8;c++)
+                if (board.at(r,c).type!=EMPTY)
+                    h^=z.piece[board.at(r,c).color][board.at(r,c).type][r*8+c];
+        if (currentPlayer==BLACK) h^=z.side;
+        h^=z.castling[castlingRights()];
+        if (enPassantCol>=0) h^=z.enPassant[enPassantCol];
+        return h;
+    }
+
+    // positionHash() without the en passant file when no pawn of the side to
+    // move stands beside the pawn that just advanced two squares: an unusable
+    // en passant right does not make positions different.
+    uint64_t repetitionKey() {
+        uint64_t h=positionHash();
+        if (enPassantCol<0) return h;
+        for (int c=enPassantCol-1;c<=enPassantCol+1;c+=2)
+            if (isValid(enPassantRow,c) && board.at(enPassantRow,c).type==PAWN &&
+                board.at(enPassantRow,c).color==currentPlayer) return h;
+        return h^zobrist().enPassant[enPassantCol];
+    }
+
+    bool insufficientMaterial() {
+        int minor=0;
+        for (int sq=0;sq<64;sq++) {
+            Piece p=board.at(sq/8,sq%8);
+            if (p.type!=EMPTY && p.type!=KING) {
+                if (p.type==BISHOP||p.type==KNIGHT) minor++;
+                else return false;
+            }
+        }
+        return minor<=1;
+    }
+
+    string getGameStatus() {
+        if (repetitionCount()>=3) return "draw (threefold repetition)";
+        if (halfMoveClock>=100) return "draw (50-move rule)";
+        if (insufficientMaterial()) return "draw (insufficient material)";
+
+        if (!hasLegalMove())
+            return isInCheck(currentPlayer)?"checkmate":"stalemate";
+        if (isInCheck(currentPlayer)) return "check";
+        return "active";
+    }
+
+
+    // ---------- MAKE MOVE ----------
+    // Squares and counters touched by applyMove(), enough to take it back.
+    struct UndoInfo {
+        Piece from, to, epVictim, rookFrom, rookTo;
+        int enPassantCol, enPassantRow, halfMoveClock;
+    };
+
+    // Board-only make: the game tree is left alone.
+    // Used by search and by makeMove() below.
+    void applyMove(const Move& m, UndoInfo& u) {
+        if (board.at(m.fromRow,m.fromCol).color==WHITE) applyMove<WHITE>(m,u);
+        else applyMove<BLACK>(m,u);
+    }
+
+    void unapplyMove(const Move& m, const UndoInfo& u) {
+        if (u.from.color==WHITE) unapplyMove<WHITE>(m,u);
+        else unapplyMove<BLACK>(m,u);
+    }
+
+    // Us is the colour of the moving piece.
+    template<Color Us>
+    void applyMove(const Move& m, UndoInfo& u) {
+        Piece p=board.at(m.fromRow,m.fromCol);
+        u.from=p;
+        u.to=board.at(m.toRow,m.toCol);
+        u.enPassantCol=enPassantCol;
+        u.enPassantRow=enPassantRow;
+        u.halfMoveClock=halfMoveClock;
+
+        if (p.type==PAWN || board.at(m.toRow,m.toCol).type!=EMPTY)
+            halfMoveClock=0;
+        else halfMoveClock++;
+
+        // 🔥 FIX: En Passant - remove the captured pawn (it's NOT at the target square!)
+        if (m.isEnPassant) {
+            // The captured pawn is one row back from where we're moving
+            int capturedPawnRow = m.toRow - Side<Us>::PAWN_DIR;
+            u.epVictim = board.at(capturedPawnRow,m.toCol);
+            board.set(capturedPawnRow, m.toCol, Piece());
+        }
+
+        // Update en passant tracking
+        enPassantCol=enPassantRow=-1;
+        if (p.type==PAWN && m.toRow-m.fromRow==2*Side<Us>::PAWN_DIR) {
+            enPassantCol=m.toCol;
+            enPassantRow=m.toRow;  // This is the target row for en passant capture
+        }
+
+        // Handle castling
+        if (m.isCastling) {
+            int rookFrom = m.toCol>m.fromCol?7:0;
+            int rookTo   = m.toCol>m.fromCol?m.toCol-1:m.toCol+1;
+            u.rookFrom=board.at(m.fromRow,rookFrom);
+            u.rookTo=board.at(m.fromRow,rookTo);
+            board.set(m.fromRow,rookTo,board.at(m.fromRow,rookFrom));
+            board.set(m.fromRow,rookFrom,Piece());
+        }
+
+        // Move the piece, promoting if needed
+        p.hasMoved=true;
+        if (m.promotion!=EMPTY)
+            p.type=m.promotion;
+        board.set(m.toRow,m.toCol,p);
+        board.set(m.fromRow,m.fromCol,Piece());
+
+        currentPlayer=opponent(currentPlayer);
+    }
+
+    template<Color Us>
+    void unapplyMove(const Move& m, const UndoInfo& u) {
+        currentPlayer=opponent(currentPlayer);
+        board.set(m.fromRow,m.fromCol,u.from);
+        board.set(m.toRow,m.toCol,u.to);
+        if (m.isEnPassant)
+            board.set(m.toRow-Side<Us>::PAWN_DIR,m.toCol,u.epVictim);
+        if (m.isCastling) {
+            int rookFrom = m.toCol>m.fromCol?7:0;
+            int rookTo   = m.toCol>m.fromCol?m.toCol-1:m.toCol+1;
+            board.set(m.fromRow,rookFrom,u.rookFrom);
+            board.set(m.fromRow,rookTo,u.rookTo);
+        }
+        enPassantCol=u.enPassantCol;
+        enPassantRow=u.enPassantRow;
+        halfMoveClock=u.halfMoveClock;
+    }
+
+    // ---------- GAME TREE ----------
+    // One node per move tried from its parent position; siblings are the
+    // alternatives, oldest first. Nodes are never freed individually.
+    struct VariationNode {
+        Move move;                  // move into this node (unused at the root)
+        UndoInfo undo;              // takes the move back
+        uint64_t hash;              // repetitionKey() after the move
+        VariationNode* parent;
+        VariationNode* firstChild;
+        VariationNode* nextSibling;
+        VariationNode* lastVisited; // child redo() returns to
+        int ply;                    // distance from the root
+        Checkpoint* checkpoint;     // set when ply is a multiple of CHECKPOINT_INTERVAL
+    };
+
+    // loadFen() admits at most 32 pieces and moves never add any, so all fit.
+    void saveCheckpoint(Checkpoint& cp) {
+        memset(&cp,0,sizeof(cp));
+        packPlacement([&](int sq) {
+            Piece p=board.at(sq/8,sq%8);
+            if (p.type!=EMPTY && p.hasMoved) cp.moved|=1ULL<<sq;
+            return p;
+        },cp.occupancy,cp.pieces);
+        cp.side=uint8_t(currentPlayer);
+        cp.epCol=int8_t(enPassantCol);
+        cp.epRow=int8_t(enPassantRow);
+        cp.halfMoveClock=halfMoveClock;
+    }
+
+    void loadCheckpoint(const Checkpoint& cp) {
+        board.clear();
+        unpackPlacement(cp.occupancy,cp.pieces,[&](int sq,Piece p) {
+            p.hasMoved=cp.moved>>sq&1;
+            board.set(sq/8,sq%8,p);
+        });
+        currentPlayer=Color(cp.side);
+        enPassantCol=cp.epCol;
+        enPassantRow=cp.epRow;
+        halfMoveClock=cp.halfMoveClock;
+    }
+
+    // Plays m from the cursor, reusing the child for m if this line was
+    // already tried, else adding it as a new variation.
+    void makeMove(Move m) {
+        VariationNode* child=cursor->firstChild;
+        VariationNode** link=&cursor->firstChild;
+        for (;child;link=&child->nextSibling,child=child->nextSibling)
+            if (packMove(child->move)==packMove(m)) break;
+        bool added=!child;
+        if (added) {
+            child=newNode(cursor);
+            child->move=m;
+            *link=child;
+        }
+        applyMove(child->move,child->undo);
+        child->hash=repetitionKey();
+        if (added && child->ply%CHECKPOINT_INTERVAL==0) addCheckpoint(child);
+        cursor->lastVisited=child;
+        cursor=child;
+    }
+
+    void undo() {
+        if (!cursor->parent) return;
+        unapplyMove(cursor->move,cursor->undo);
+        cursor=cursor->parent;
+    }
+
+    void redo() {
+        VariationNode* next=cursor->lastVisited;
+        if (!next) return;
+        applyMove(next->move,next->undo);
+        cursor=next;
+    }
+
+    // Jumps to ply `ply` of the current line: the path to the cursor plus the
+    // moves redo() would replay. Restores the last checkpoint at or before the
+    // target and replays at most CHECKPOINT_INTERVAL-1 moves, or steps from
+    // the cursor when that is shorter. False if the line is not that long.
+    bool goTo(int ply) {
+        if (ply<0) return false;
+        VariationNode* target=cursor;
+        while (target->ply>ply) target=target->parent;
+        while (target->ply<ply && target->lastVisited) target=target->lastVisited;
+        if (target->ply!=ply) return false;
+
+        if (abs(ply-cursor->ply)<=ply%CHECKPOINT_INTERVAL) {
+            while (cursor->ply>ply) undo();
+            while (cursor->ply<ply) redo();
+            return true;
+        }
+        VariationNode* path[CHECKPOINT_INTERVAL];
+        int n=0;
+        VariationNode* base=target;
+        while (!base->checkpoint) { path[n++]=base; base=base->parent; }
+        loadCheckpoint(*base->checkpoint);
+        while (n>0) {
+            VariationNode* v=path[--n];
+            applyMove(v->move,v->undo);
+        }
+        cursor=target;
+        return true;
+    }
+
+    int currentPly() const { return cursor->ply; }
+    const VariationNode* rootNode() const { return root; }
+    const VariationNode* currentNode() const { return cursor; }
+
+    bool parseMove(string s,Move &m) {
+        if (s.size()<4) return false;
+        for(char &c:s)c=tolower(c);
+        m.fromCol=s[0]-'a'; m.fromRow=8-(s[1]-'0');
+        m.toCol=s[2]-'a';   m.toRow=8-(s[3]-'0');
+        if (s.size()>=5) {
+            char p=toupper(s[4]);
+            if (p=='Q')m.promotion=QUEEN;
+            if (p=='R')m.promotion=ROOK;
+            if (p=='B')m.promotion=BISHOP;
+            if (p=='N')m.promotion=KNIGHT;
+        }
+        return isValid(m.fromRow,m.fromCol)&&isValid(m.toRow,m.toCol);
+    }
+
+    // Complete a parsed move (castling and en passant flags) and check it is
+    // legal. A promotion without a piece letter defaults to a queen.
+    bool findLegalMove(const Move& u,Move &a) {
+        if (!isValid(u.fromRow,u.fromCol) || !isValid(u.toRow,u.toCol)) return false;
+        Move m=u;
+        fillMoveFlags(m);
+        if (m.promotion==EMPTY && board.at(m.fromRow,m.fromCol).type==PAWN &&
+            m.toRow==(currentPlayer==WHITE?0:7)) m.promotion=QUEEN;
+        if (!isLegal(m)) return false;
+        a=m;
+        return true;
+    }
+
+    // Resolve a SAN move ("Nf3", "exd5", "e8=Q+", "O-O") against the legal list.
+    bool parseSan(string s,Move &a) {
+        while (!s.empty() && string("+#!?").find(s.back())!=string::npos) s.pop_back();
+        if (s=="O-O" || s=="0-0" || s=="O-O-O" || s=="0-0-0") {
+            bool queenSide=s.size()==5;
+            for (auto m:getLegalMoves(currentPlayer))
+                if (m.isCastling && (m.toCol<m.fromCol)==queenSide) { a=m; return true; }
+            return false;
+        }
+        PieceType piece=PAWN, promo=EMPTY;
+        size_t eq=s.find('=');
+        if (eq!=string::npos) {
+            if (eq+1<s.size()) promo=pieceFromChar(s[eq+1]);
+            s=s.substr(0,eq);
+        } else if (s.size()>2 && string("NBRQ").find(s.back())!=string::npos &&
+                   isdigit((unsigned char)s[s.size()-2])) {
+            promo=pieceFromChar(s.back());
+            s.pop_back();
+        }
+        if (!s.empty() && string("NBRQK").find(s[0])!=string::npos) {
+            piece=pieceFromChar(s[0]);
+            s=s.substr(1);
+        }
+        if (s.size()<2) return false;
+        int toCol=s[s.size()-2]-'a', toRow=8-(s.back()-'0');
+        int fromCol=-1, fromRow=-1;
+        for (size_t i=0;i+2<s.size();i++) {
+            if (s[i]>='a' && s[i]<='h') fromCol=s[i]-'a';
+            else if (s[i]>='1' && s[i]<='8') fromRow=8-(s[i]-'0');
+        }
+        for (auto m:getLegalMoves(currentPlayer))
+            if (board.at(m.fromRow,m.fromCol).type==piece &&
+                m.toRow==toRow && m.toCol==toCol && m.promotion==promo &&
+                (fromCol<0 || m.fromCol==fromCol) && (fromRow<0 || m.fromRow==fromRow)) {
+                a=m; return true;
+            }
+        return false;
+    }
+
+    PieceType pieceFromChar(char ch) {
+        switch (toupper(ch)) {
+            case 'P': return PAWN;
+            case 'N': return KNIGHT;
+            case 'B': return BISHOP;
+            case 'R': return ROOK;
+            case 'Q': return QUEEN;
+            case 'K': return KING;
+        }
+        return EMPTY;
+    }
+
+    // ---------- STREAMLIT-FRIENDLY OUTPUT ----------
+    void printState() {
+        cout << "BOARD\n";
+        for (int r=0;r<8;r++) {
+            for (int c=0;c<8;c++) {
+                cout << getPieceChar(board.at(r,c));
+                if (c<7) cout<<" ";
+            }
+            cout<<"\n";
+        }
+        cout << "TURN " << (currentPlayer==WHITE?"WHITE":"BLACK") << "\n";
+        cout << "STATUS " << getGameStatus() << "\n";
+        cout << flush;
+    }
+};
+
+typedef BasicChessGame<BitboardBoard> ChessGame;
+
+#endif // CHESS_ENGINE_H
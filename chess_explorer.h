@@ -0,0 +1,138 @@
+#ifndef CHESS_EXPLORER_H
+#define CHESS_EXPLORER_H
+
+#include "chess_engine.h"
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ================= OPENING EXPLORER INDEX =================
+// On-disk layout (little endian, written by explorer_build):
+//   ExplorerHeader
+//   ExplorerPosition[positionCount]   sorted by key
+//   ExplorerMove[moveCount]           grouped per position, most played first
+//   uint32_t gameIds[postingCount]    grouped per position, ascending
+
+struct ExplorerHeader {
+    char magic[8];          // "CHESSEXP"
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t positionCount;
+    uint64_t moveCount;
+    uint64_t postingCount;
+    uint64_t gameCount;
+};
+
+struct ExplorerPosition {
+    uint64_t key;           // ChessGame::repetitionKey()
+    uint32_t firstMove, moveCount;
+    uint32_t firstPosting, postingCount;
+};
+
+struct ExplorerMove {
+    uint16_t move;          // packMove()
+    uint16_t reserved;
+    uint32_t games, whiteWins, draws, blackWins;
+};
+
+static const char EXPLORER_MAGIC[8]={'C','H','E','S','S','E','X','P'};
+static const uint32_t EXPLORER_VERSION=2;     // 2: keyed by repetitionKey()
+
+// Read-only view of an index file, memory-mapped where the platform allows.
+class OpeningExplorer {
+private:
+    const unsigned char* data;
+    size_t size;
+    const ExplorerHeader* header;
+    const ExplorerPosition* positions;
+    const ExplorerMove* moveTable;
+    const uint32_t* postingTable;
+    MemoryAccount mem{MEM_EXPLORER};
+#ifdef _WIN32
+    vector<unsigned char> buffer;
+#endif
+
+    void unmap() {
+#ifndef _WIN32
+        if (data) munmap((void*)data,size);
+#else
+        buffer.clear();
+#endif
+        data=nullptr; size=0; header=nullptr;
+        mem.set(0);
+    }
+
+public:
+    OpeningExplorer() : data(nullptr), size(0), header(nullptr),
+        positions(nullptr), moveTable(nullptr), postingTable(nullptr) {}
+    ~OpeningExplorer() { unmap(); }
+
+    OpeningExplorer(const OpeningExplorer&) = delete;
+    OpeningExplorer& operator=(const OpeningExplorer&) = delete;
+
+    bool open(const string& path) {
+        unmap();
+#ifndef _WIN32
+        int fd=::open(path.c_str(),O_RDONLY);
+        if (fd<0) return false;
+        struct stat st;
+        if (fstat(fd,&st)!=0 || st.st_size<(off_t)sizeof(ExplorerHeader)) {
+            ::close(fd); return false;
+        }
+        void* p=mmap(nullptr,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+        ::close(fd);
+        if (p==MAP_FAILED) return false;
+        data=(const unsigned char*)p;
+        size=st.st_size;
+#else
+        ifstream in(path,ios::binary);
+        if (!in) return false;
+        buffer.assign(istreambuf_iterator<char>(in),istreambuf_iterator<char>());
+        if (buffer.size()<sizeof(ExplorerHeader)) { buffer.clear(); return false; }
+        data=buffer.data();
+        size=buffer.size();
+#endif
+        header=(const ExplorerHeader*)data;
+        size_t need=sizeof(ExplorerHeader)+
+            header->positionCount*sizeof(ExplorerPosition)+
+            header->moveCount*sizeof(ExplorerMove)+
+            header->postingCount*sizeof(uint32_t);
+        if (memcmp(header->magic,EXPLORER_MAGIC,8)!=0 ||
+            header->version!=EXPLORER_VERSION || need>size) {
+            unmap();
+            return false;
+        }
+        positions=(const ExplorerPosition*)(data+sizeof(ExplorerHeader));
+        moveTable=(const ExplorerMove*)(positions+header->positionCount);
+        postingTable=(const uint32_t*)(moveTable+header->moveCount);
+        mem.set(size);
+        return true;
+    }
+
+    bool isOpen() { return header!=nullptr; }
+    uint64_t gameCount() { return header?header->gameCount:0; }
+
+    // Binary search over the sorted position table.
+    const ExplorerPosition* find(uint64_t key) {
+        if (!header) return nullptr;
+        const ExplorerPosition* end=positions+header->positionCount;
+        const ExplorerPosition* it=lower_bound(positions,end,key,
+            [](const ExplorerPosition& p,uint64_t k){ return p.key<k; });
+        return (it!=end && it->key==key)?it:nullptr;
+    }
+
+    const ExplorerMove* moves(const ExplorerPosition* p) { return moveTable+p->firstMove; }
+    const uint32_t* postings(const ExplorerPosition* p) { return postingTable+p->firstPosting; }
+};
+
+#endif // CHESS_EXPLORER_H
@@ -80,8 +80,8 @@ def compile_engine():
     try:
         st.info("🔨 Compiling C++ engine... (this happens once)")
         
-        # Compile with g++
-        compile_cmd = ["g++", "-std=c++17", "-O2", cpp_file, "-o", engine_exe]
+        # Compile with g++ (same flags as the CMake Release build)
+        compile_cmd = ["g++", "-std=c++17", "-O3", "-flto", "-pthread", cpp_file, "-o", engine_exe]
         result = subprocess.run(
             compile_cmd,
             capture_output=True,
@@ -0,0 +1,232 @@
+#ifndef CHESS_KERNELS_H
+#define CHESS_KERNELS_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// ================= BITBOARDS =================
+// One bit per square, bit index row*8+col (row 0 = rank 8) as everywhere
+// else. Indices follow the Color and PieceType enums: pieces[WHITE][KNIGHT].
+struct Bitboards {
+    uint64_t pieces[3][7];
+    uint64_t color[3];
+};
+
+// Ray directions: 0-3 run towards higher square numbers (nearest blocker is
+// the lowest set bit), 4-7 towards lower ones. Even directions are straight,
+// odd ones diagonal.
+static constexpr int RAY_DR[8]={0,1,1,1, 0,-1,-1,-1};
+static constexpr int RAY_DC[8]={1,1,0,-1, -1,-1,0,1};
+
+// ================= GEOMETRY TABLES =================
+// Built by constexpr constructors, so they are plain read-only data in the
+// binary: nothing runs at startup and forked or concurrent engine processes
+// share the pages.
+constexpr uint64_t squareBit(int r,int c) {
+    return (r>=0 && r<8 && c>=0 && c<8)?1ULL<<(r*8+c):0;
+}
+
+struct AttackTables {
+    uint64_t pawn[3][64]{};     // squares a pawn of that colour attacks
+    uint64_t knight[64]{};
+    uint64_t king[64]{};
+    uint64_t ray[8][64]{};      // squares strictly beyond sq, to the edge
+
+    constexpr AttackTables() {
+        const int KN[8][2]={{-2,-1},{-2,1},{-1,-2},{-1,2},{1,-2},{1,2},{2,-1},{2,1}};
+        for (int sq=0;sq<64;sq++) {
+            int r=sq/8, c=sq%8;
+            pawn[1][sq]=squareBit(r-1,c-1)|squareBit(r-1,c+1);     // white moves towards row 0
+            pawn[2][sq]=squareBit(r+1,c-1)|squareBit(r+1,c+1);
+            for (int k=0;k<8;k++) knight[sq]|=squareBit(r+KN[k][0],c+KN[k][1]);
+            for (int dr=-1;dr<=1;dr++)
+                for (int dc=-1;dc<=1;dc++)
+                    if (dr||dc) king[sq]|=squareBit(r+dr,c+dc);
+            for (int d=0;d<8;d++)
+                for (int i=1;i<8;i++) ray[d][sq]|=squareBit(r+RAY_DR[d]*i,c+RAY_DC[d]*i);
+        }
+    }
+};
+
+// Pairs of squares on a common rank, file or diagonal: between[a][b] holds
+// the squares strictly between them, line[a][b] the whole line through both
+// (edge to edge, a and b included). Both are 0 for unaligned pairs and for
+// a==b. distance is the king distance.
+struct LineTables {
+    uint64_t between[64][64]{};
+    uint64_t line[64][64]{};
+    uint8_t distance[64][64]{};
+
+    constexpr LineTables() {
+        for (int a=0;a<64;a++) {
+            int ar=a/8, ac=a%8;
+            for (int b=0;b<64;b++) {
+                int br=b/8, bc=b%8;
+                int dr=br-ar, dc=bc-ac;
+                int adr=dr<0?-dr:dr, adc=dc<0?-dc:dc;
+                distance[a][b]=uint8_t(adr>adc?adr:adc);
+                if (a==b || (dr && dc && adr!=adc)) continue;
+                int sr=(dr>0)-(dr<0), sc=(dc>0)-(dc<0);
+                for (int r=ar+sr,c=ac+sc;r!=br || c!=bc;r+=sr,c+=sc)
+                    between[a][b]|=squareBit(r,c);
+                for (int i=-7;i<=7;i++) line[a][b]|=squareBit(ar+sr*i,ac+sc*i);
+            }
+        }
+    }
+};
+
+inline constexpr AttackTables ATTACK_TABLES{};
+inline constexpr LineTables LINE_TABLES{};
+
+inline const AttackTables& attackTables() { return ATTACK_TABLES; }
+inline const LineTables& lineTables() { return LINE_TABLES; }
+
+// ================= EVALUATION TABLES =================
+// Material plus piece-square tables, white's view with row 0 = rank 8
+// (the board layout); black reads them mirrored.
+static const int PIECE_VALUE[7]={0,100,320,330,500,900,0};
+
+static const int PST[7][64]={
+    {0},
+    {  0,  0,  0,  0,  0,  0,  0,  0,     // PAWN
+      50, 50, 50, 50, 50, 50, 50, 50,
+      10, 10, 20, 30, 30, 20, 10, 10,
+       5,  5, 10, 25, 25, 10,  5,  5,
+       0,  0,  0, 20, 20,  0,  0,  0,
+       5, -5,-10,  0,  0,-10, -5,  5,
+       5, 10, 10,-20,-20, 10, 10,  5,
+       0,  0,  0,  0,  0,  0,  0,  0},
+    {-50,-40,-30,-30,-30,-30,-40,-50,    // KNIGHT
+     -40,-20,  0,  0,  0,  0,-20,-40,
+     -30,  0, 10, 15, 15, 10,  0,-30,
+     -30,  5, 15, 20, 20, 15,  5,-30,
+     -30,  0, 15, 20, 20, 15,  0,-30,
+     -30,  5, 10, 15, 15, 10,  5,-30,
+     -40,-20,  0,  5,  5,  0,-20,-40,
+     -50,-40,-30,-30,-30,-30,-40,-50},
+    {-20,-10,-10,-10,-10,-10,-10,-20,    // BISHOP
+     -10,  0,  0,  0,  0,  0,  0,-10,
+     -10,  0,  5, 10, 10,  5,  0,-10,
+     -10,  5,  5, 10, 10,  5,  5,-10,
+     -10,  0, 10, 10, 10, 10,  0,-10,
+     -10, 10, 10, 10, 10, 10, 10,-10,
+     -10,  5,  0,  0,  0,  0,  5,-10,
+     -20,-10,-10,-10,-10,-10,-10,-20},
+    {  0,  0,  0,  0,  0,  0,  0,  0,    // ROOK
+       5, 10, 10, 10, 10, 10, 10,  5,
+      -5,  0,  0,  0,  0,  0,  0, -5,
+      -5,  0,  0,  0,  0,  0,  0, -5,
+      -5,  0,  0,  0,  0,  0,  0, -5,
+      -5,  0,  0,  0,  0,  0,  0, -5,
+      -5,  0,  0,  0,  0,  0,  0, -5,
+       0,  0,  0,  5,  5,  0,  0,  0},
+    {-20,-10,-10, -5, -5,-10,-10,-20,    // QUEEN
+     -10,  0,  0,  0,  0,  0,  0,-10,
+     -10,  0,  5,  5,  5,  5,  0,-10,
+      -5,  0,  5,  5,  5,  5,  0, -5,
+       0,  0,  5,  5,  5,  5,  0, -5,
+     -10,  5,  5,  5,  5,  5,  0,-10,
+     -10,  0,  5,  0,  0,  0,  0,-10,
+     -20,-10,-10, -5, -5,-10,-10,-20},
+    {-30,-40,-40,-50,-50,-40,-40,-30,    // KING
+     -30,-40,-40,-50,-50,-40,-40,-30,
+     -30,-40,-40,-50,-50,-40,-40,-30,
+     -30,-40,-40,-50,-50,-40,-40,-30,
+     -20,-30,-30,-40,-40,-30,-30,-20,
+     -10,-20,-20,-20,-20,-20,-20,-10,
+      20, 20,  0,  0,  0,  0, 20, 20,
+      20, 30, 10,  0,  0, 10, 30, 20}
+};
+
+// ================= ISA DISPATCH =================
+// The hot kernels are compiled once per instruction set level and the best
+// one the CPU supports is picked at startup, so a single binary runs on any
+// x86-64 and still uses POPCNT/BMI2/AVX2 where present. Set CHESS_ISA to a
+// level name to force a lower one (for comparisons). Only whole kernels are
+// dispatched; bit scans are single instructions and stay inline.
+struct KernelTable {
+    const char* isa;
+    bool (*squareAttacked)(const Bitboards&,int sq,int by);
+    int (*evaluate)(const Bitboards&);     // centipawns, white's view
+};
+
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define CHESS_MULTI_ISA 1
+#endif
+
+namespace kernels_baseline {
+#define CHESS_KERNEL_ISA "baseline"
+#include "chess_kernels.inc"
+#undef CHESS_KERNEL_ISA
+}
+
+// Bit scans for the rules code, inlined at the call site. Without POPCNT in
+// the build flags GCC makes __builtin_popcountll a library call on x86, so
+// that case counts bits in registers instead.
+using kernels_baseline::lsb;
+using kernels_baseline::msb;
+
+inline int popcount(uint64_t b) {
+#if defined(__GNUC__) && (defined(__POPCNT__) || !(defined(__x86_64__) || defined(__i386__)))
+    return __builtin_popcountll(b);
+#else
+    b-=(b>>1)&0x5555555555555555ULL;
+    b=(b&0x3333333333333333ULL)+((b>>2)&0x3333333333333333ULL);
+    b=(b+(b>>4))&0x0F0F0F0F0F0F0F0FULL;
+    return int((b*0x0101010101010101ULL)>>56);
+#endif
+}
+
+#ifdef CHESS_MULTI_ISA
+#pragma GCC push_options
+#pragma GCC target("popcnt,sse4.2")
+namespace kernels_x86_64_v2 {
+#define CHESS_KERNEL_ISA "x86-64-v2"
+#include "chess_kernels.inc"
+#undef CHESS_KERNEL_ISA
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("popcnt,sse4.2,avx2,bmi,bmi2,lzcnt,fma")
+namespace kernels_x86_64_v3 {
+#define CHESS_KERNEL_ISA "x86-64-v3"
+#include "chess_kernels.inc"
+#undef CHESS_KERNEL_ISA
+}
+#pragma GCC pop_options
+#endif
+
+inline const KernelTable* selectKernels() {
+    const KernelTable* levels[3]={&kernels_baseline::KERNELS,nullptr,nullptr};
+    int best=0;
+#ifdef CHESS_MULTI_ISA
+    __builtin_cpu_init();
+    levels[1]=&kernels_x86_64_v2::KERNELS;
+    levels[2]=&kernels_x86_64_v3::KERNELS;
+    if (__builtin_cpu_supports("popcnt") && __builtin_cpu_supports("sse4.2")) {
+        best=1;
+#if __GNUC__>=11
+        bool lzcnt=__builtin_cpu_supports("lzcnt");
+#else
+        bool lzcnt=__builtin_cpu_supports("abm");     // LZCNT came with ABM
+#endif
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") &&
+            __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("fma") && lzcnt)
+            best=2;
+    }
+#endif
+    if (const char* force=getenv("CHESS_ISA"))
+        for (int i=0;i<best;i++)
+            if (!strcmp(force,levels[i]->isa)) best=i;
+    return levels[best];
+}
+
+// Picked during static initialisation, ahead of anything that includes this
+// header, so calls need no first-use guard.
+inline const KernelTable* const KERNEL_TABLE=selectKernels();
+
+inline const KernelTable& kernels() { return *KERNEL_TABLE; }
+
+#endif // CHESS_KERNELS_H
@@ -0,0 +1,157 @@
+#ifndef CHESS_LATENCY_H
+#define CHESS_LATENCY_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "chess_kernels.h"
+
+// ================= PERCENTILES =================
+// Nearest rank, used by every report (latency, bench, microbench, perf
+// gate): the p-quantile of n samples is the ceil(p*n)-th smallest, so with
+// few samples p99 is the largest one. Returns a 0-based index.
+inline size_t nearestRank(double p,size_t n) {
+    size_t rank=std::max<size_t>(1,(size_t)std::ceil(p*n-1e-9));
+    return std::min(rank,n)-1;
+}
+
+// v must be sorted ascending.
+template<class T> T sortedPercentile(const std::vector<T>& v,double p) {
+    return v.empty()?T():v[nearestRank(p,v.size())];
+}
+
+// ================= LATENCY HISTOGRAMS =================
+// Fixed log-linear buckets over nanoseconds: values below 8 are exact, then
+// every power of two is split into 8 equal sub-buckets (<= 12.5% error).
+// The top bucket holds everything from about 18 minutes up.
+class LatencyHistogram {
+public:
+    static const int SUB=8;
+    static const int MAX_EXP=40;
+    static const int BUCKETS=(MAX_EXP-1)*SUB;
+
+private:
+    uint64_t counts[BUCKETS];
+    uint64_t total, sum, maximum;
+
+    static int bucketOf(uint64_t v) {
+        if (v<SUB) return (int)v;
+        int e=kernels_baseline::msb(v);
+        if (e>MAX_EXP) return BUCKETS-1;
+        int b=(e-2)*SUB+int((v>>(e-3))&(SUB-1));
+        return b<BUCKETS?b:BUCKETS-1;
+    }
+
+    // smallest value that lands in bucket b
+    static uint64_t bucketLow(int b) {
+        if (b<SUB) return (uint64_t)b;
+        int e=b/SUB+2;
+        return uint64_t(SUB+b%SUB)<<(e-3);
+    }
+
+public:
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        for (auto& c:counts) c=0;
+        total=sum=maximum=0;
+    }
+
+    void record(uint64_t ns) {
+        counts[bucketOf(ns)]++;
+        total++;
+        sum+=ns;
+        if (ns>maximum) maximum=ns;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maximum; }
+    double mean() const { return total?double(sum)/total:0; }
+
+    // Nearest rank: midpoint of the bucket holding that sample, clamped to
+    // the maximum; the top rank is the maximum.
+    uint64_t percentile(double p) const {
+        if (!total) return 0;
+        uint64_t rank=nearestRank(p,(size_t)total)+1, seen=0;
+        if (rank>=total) return maximum;
+        for (int b=0;b<BUCKETS;b++) {
+            seen+=counts[b];
+            if (seen>=rank) {
+                uint64_t lo=bucketLow(b), hi=b+1<BUCKETS?bucketLow(b+1):lo;
+                uint64_t mid=lo+(hi-lo)/2;
+                return mid<maximum?mid:maximum;
+            }
+        }
+        return maximum;
+    }
+};
+
+// ---------- per-command recorder ----------
+// STATUS is the BOARD/TURN/STATUS reply that follows every command; the
+// other kinds exclude it.
+enum LatencyKind { LAT_MOVE, LAT_UNDO, LAT_REDO, LAT_STATUS, LAT_GO, LAT_POSITION, LAT_EXPLORE, LAT_GOTO, LAT_COUNT };
+
+static const char* const LATENCY_NAMES[LAT_COUNT]={
+    "MOVE", "UNDO", "REDO", "STATUS", "GO", "POSITION", "EXPLORE", "GOTO"
+};
+
+inline int latencyKind(const std::string& cmd) {
+    for (int k=0;k<LAT_COUNT;k++)
+        if (cmd==LATENCY_NAMES[k] && k!=LAT_STATUS) return k;
+    return -1;
+}
+
+class LatencyRecorder {
+private:
+    typedef std::chrono::steady_clock clock;
+    LatencyHistogram hist[LAT_COUNT];
+    clock::duration dumpEvery;
+    clock::time_point lastDump;
+
+public:
+    LatencyRecorder() : dumpEvery(clock::duration::zero()), lastDump(clock::now()) {}
+
+    void record(int kind,clock::time_point since) {
+        if (kind<0) return;
+        hist[kind].record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now()-since).count());
+    }
+
+    void reset() { for (auto& h:hist) h.reset(); }
+
+    // 0 disables the periodic dump
+    void setDumpInterval(double seconds) {
+        dumpEvery=std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    // Called between commands; no timer thread, so an idle engine stays quiet.
+    void maybeDump(std::ostream& out) {
+        if (dumpEvery==clock::duration::zero() || clock::now()-lastDump<dumpEvery) return;
+        lastDump=clock::now();
+        print(out);
+    }
+
+    // LATENCY <kind> count N mean p50 p90 p99 max, in microseconds
+    void print(std::ostream& out) const {
+        auto us=[](double ns) { return ns/1000; };
+        std::ios::fmtflags flags=out.flags();
+        std::streamsize precision=out.precision();
+        out<<std::fixed<<std::setprecision(1);
+        for (int k=0;k<LAT_COUNT;k++) {
+            const LatencyHistogram& h=hist[k];
+            out<<"LATENCY "<<LATENCY_NAMES[k]<<" count "<<h.count()
+               <<" mean "<<us(h.mean())<<" p50 "<<us((double)h.percentile(0.5))
+               <<" p90 "<<us((double)h.percentile(0.9))<<" p99 "<<us((double)h.percentile(0.99))
+               <<" max "<<us((double)h.max())<<" us\n";
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+};
+
+#endif // CHESS_LATENCY_H
@@ -0,0 +1,92 @@
+#ifndef CHESS_MEMORY_H
+#define CHESS_MEMORY_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// ================= MEMORY ACCOUNTING =================
+// Process-wide byte counts per subsystem, updated by the owners as they
+// grow and shrink (never by walking the structures). Session contents live
+// in arena blocks, so the game trees are bytes used inside MEM_ARENA and are
+// left out of the total.
+enum MemCategory {
+    MEM_TREE,               // game tree nodes
+    MEM_ARENA,              // arena blocks reserved by the block pool
+    MEM_SESSIONS,           // ChessGame slots reserved by the session pool
+    MEM_HASH,               // transposition tables
+    MEM_EXPLORER,           // opening index (mapped, mostly not resident)
+    MEM_COUNT
+};
+
+static const char* const MEM_NAMES[MEM_COUNT]={
+    "tree", "arena", "sessions", "hash", "explorer"
+};
+
+static const bool MEM_IN_TOTAL[MEM_COUNT]={
+    false, true, true, true, false
+};
+
+inline std::atomic<int64_t>* memoryCounters() {
+    static std::atomic<int64_t> counters[MEM_COUNT];
+    return counters;
+}
+
+inline void memoryAdd(int category,int64_t bytes) {
+    memoryCounters()[category].fetch_add(bytes,std::memory_order_relaxed);
+}
+
+// Bytes one owner has charged to a category; released on destruction so an
+// owner only has to report changes.
+class MemoryAccount {
+private:
+    int category;
+    int64_t bytes;
+
+public:
+    explicit MemoryAccount(int cat) : category(cat), bytes(0) {}
+    MemoryAccount(const MemoryAccount& o) : category(o.category), bytes(o.bytes) { memoryAdd(category,bytes); }
+    MemoryAccount& operator=(const MemoryAccount& o) {
+        if (this!=&o) { memoryAdd(category,-bytes); category=o.category; bytes=o.bytes; memoryAdd(category,bytes); }
+        return *this;
+    }
+    ~MemoryAccount() { memoryAdd(category,-bytes); }
+
+    void add(int64_t delta) { bytes+=delta; memoryAdd(category,delta); }
+    void set(int64_t value) { add(value-bytes); }
+    int64_t value() const { return bytes; }
+};
+
+// Resident set size from /proc where available, else 0.
+inline int64_t residentBytes() {
+#ifdef __linux__
+    long pages=0, resident=0;
+    FILE* f=fopen("/proc/self/statm","r");
+    if (!f) return 0;
+    int n=fscanf(f,"%ld %ld",&pages,&resident);
+    fclose(f);
+    return n==2?(int64_t)resident*sysconf(_SC_PAGESIZE):0;
+#else
+    return 0;
+#endif
+}
+
+// MEMORY <subsystem> <bytes>, then the total of the heap reservations and
+// the process RSS for comparison.
+inline void printMemory(std::ostream& out) {
+    int64_t heap=0;
+    for (int i=0;i<MEM_COUNT;i++) {
+        int64_t v=memoryCounters()[i].load(std::memory_order_relaxed);
+        out<<"MEMORY "<<MEM_NAMES[i]<<" "<<v<<"\n";
+        if (MEM_IN_TOTAL[i]) heap+=v;
+    }
+    out<<"MEMORY total "<<heap<<"\n";
+    if (int64_t rss=residentBytes()) out<<"MEMORY rss "<<rss<<"\n";
+}
+
+#endif // CHESS_MEMORY_H
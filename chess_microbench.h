@@ -0,0 +1,222 @@
+#ifndef CHESS_MICROBENCH_H
+#define CHESS_MICROBENCH_H
+
+#include "chess_engine.h"
+#include "chess_bench.h"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <streambuf>
+
+// ================= MICROBENCHMARKS =================
+// Each benchmark is warmed up, calibrated so one sample takes about
+// targetSampleMs, then sampled repeatedly; results are ns per operation.
+struct MicroResult {
+    string name;
+    double median, p10, p90, p99, minimum;
+    int samples;
+    uint64_t iterations;    // per sample
+};
+
+struct MicroOptions {
+    int samples=30;
+    double targetSampleMs=5;
+    double warmupMs=50;
+    string filter;          // substring match on the benchmark name
+};
+
+// Defeats dead-code elimination of benchmark results.
+static volatile uint64_t microSink;
+
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*,streamsize n) override { return n; }
+};
+
+// op(n) runs the operation n times; setup() runs untimed before each sample.
+inline MicroResult measureMicro(const string& name,const MicroOptions& opt,
+                                const function<void(uint64_t)>& op,
+                                const function<void()>& setup=function<void()>()) {
+    typedef chrono::steady_clock clock;
+    auto ms=[](clock::duration d) { return chrono::duration<double,milli>(d).count(); };
+
+    uint64_t iters=1;
+    auto warmStart=clock::now();
+    while (ms(clock::now()-warmStart)<opt.warmupMs) {
+        if (setup) setup();
+        auto t0=clock::now();
+        op(iters);
+        double t=ms(clock::now()-t0);
+        if (t<opt.targetSampleMs) iters=iters*2;
+    }
+    {   // calibrate once more on a warm cache
+        if (setup) setup();
+        auto t0=clock::now();
+        op(iters);
+        double t=ms(clock::now()-t0);
+        if (t>0) iters=max<uint64_t>(1,(uint64_t)(iters*opt.targetSampleMs/t));
+    }
+
+    vector<double> ns;
+    for (int s=0;s<opt.samples;s++) {
+        if (setup) setup();
+        auto t0=clock::now();
+        op(iters);
+        ns.push_back(chrono::duration<double,nano>(clock::now()-t0).count()/iters);
+    }
+    sort(ns.begin(),ns.end());
+    MicroResult r;
+    r.name=name;
+    r.median=sortedPercentile(ns,0.5);
+    r.p10=sortedPercentile(ns,0.1);
+    r.p90=sortedPercentile(ns,0.9);
+    r.p99=sortedPercentile(ns,0.99);
+    r.minimum=ns.front();
+    r.samples=opt.samples;
+    r.iterations=iters;
+    return r;
+}
+
+// The core primitives, cycling over the bench positions.
+inline vector<MicroResult> runMicroBenchmarks(const MicroOptions& opt) {
+    vector<unique_ptr<ChessGame>> games;
+    for (int i=0;i<BENCH_POSITIONS;i++) {
+        games.emplace_back(new ChessGame());
+        games.back()->loadFen(BENCH_FENS[i]);
+    }
+    vector<vector<Move>> legal;
+    for (auto& g:games) legal.push_back(g->getLegalMoves(g->sideToMove()));
+    const size_t n=games.size();
+
+    vector<MicroResult> results;
+    auto add=[&](const string& name,const function<void(uint64_t)>& op,
+                 const function<void()>& setup=function<void()>()) {
+        if (!opt.filter.empty() && name.find(opt.filter)==string::npos) return;
+        results.push_back(measureMicro(name,opt,op,setup));
+    };
+
+    add("getLegalMoves",[&](uint64_t k) {
+        uint64_t s=0;
+        for (uint64_t i=0;i<k;i++) {
+            ChessGame& g=*games[i%n];
+            s+=g.getLegalMoves(g.sideToMove()).size();
+        }
+        microSink=s;
+    });
+    add("countLegalMoves",[&](uint64_t k) {
+        uint64_t s=0;
+        for (uint64_t i=0;i<k;i++) s+=games[i%n]->countLegalMoves();
+        microSink=s;
+    });
+    add("isSquareAttacked",[&](uint64_t k) {
+        uint64_t s=0;
+        for (uint64_t i=0;i<k;i++) {
+            ChessGame& g=*games[(i/64)%n];
+            int sq=i%64;
+            s+=g.isSquareAttacked(sq/8,sq%8,g.opponent(g.sideToMove()));
+        }
+        microSink=s;
+    });
+    // makeMove() grows the move history, so each sample starts from a fresh load
+    add("makeMove+undo",[&](uint64_t k) {
+        for (uint64_t i=0;i<k;i++) {
+            size_t p=i%n;
+            if (legal[p].empty()) continue;
+            games[p]->makeMove(legal[p][(i/n)%legal[p].size()]);
+            games[p]->undo();
+        }
+    },[&]() {
+        for (int i=0;i<BENCH_POSITIONS;i++) games[i]->loadFen(BENCH_FENS[i]);
+    });
+    add("applyMove+unapplyMove",[&](uint64_t k) {
+        for (uint64_t i=0;i<k;i++) {
+            size_t p=i%n;
+            if (legal[p].empty()) continue;
+            const Move& m=legal[p][(i/n)%legal[p].size()];
+            ChessGame::UndoInfo u;
+            games[p]->applyMove(m,u);
+            games[p]->unapplyMove(m,u);
+        }
+    });
+    // a whole short session: pool slot, arena blocks, 8 plies, teardown
+    add("newGame+8 plies",[&](uint64_t k) {
+        static const char* const line[]={"e2e4","e7e5","g1f3","b8c6","f1b5","a7a6","b5a4","g8f6"};
+        for (uint64_t i=0;i<k;i++) {
+            unique_ptr<ChessGame> g(new ChessGame());
+            for (const char* t:line) {
+                Move u,a;
+                g->parseMove(t,u);
+                if (g->findLegalMove(u,a)) g->makeMove(a);
+            }
+        }
+    });
+    add("isLegal",[&](uint64_t k) {
+        uint64_t s=0;
+        for (uint64_t i=0;i<k;i++) {
+            size_t p=i%n;
+            if (legal[p].empty()) continue;
+            s+=games[p]->isLegal(legal[p][(i/n)%legal[p].size()]);
+        }
+        microSink=s;
+    });
+    add("givesCheck",[&](uint64_t k) {
+        uint64_t s=0;
+        for (uint64_t i=0;i<k;i++) {
+            size_t p=i%n;
+            if (legal[p].empty()) continue;
+            s+=games[p]->givesCheck(legal[p][(i/n)%legal[p].size()]);
+        }
+        microSink=s;
+    });
+    add("positionHash",[&](uint64_t k) {
+        uint64_t s=0;
+        for (uint64_t i=0;i<k;i++) s^=games[i%n]->positionHash();
+        microSink=s;
+    });
+    add("getGameStatus",[&](uint64_t k) {
+        uint64_t s=0;
+        for (uint64_t i=0;i<k;i++) s+=games[i%n]->getGameStatus().size();
+        microSink=s;
+    });
+    const char* moveTexts[]={"e2e4","g1f3","e7e8q","a7a8n","h1h8","zz99","e1g1","b7b5"};
+    add("parseMove",[&](uint64_t k) {
+        uint64_t s=0;
+        Move m;
+        for (uint64_t i=0;i<k;i++) s+=games[0]->parseMove(moveTexts[i%8],m)+m.toCol;
+        microSink=s;
+    });
+    add("printState",[&](uint64_t k) {
+        NullBuffer null;
+        streambuf* old=cout.rdbuf(&null);
+        for (uint64_t i=0;i<k;i++) games[i%n]->printState();
+        cout.rdbuf(old);
+    });
+    return results;
+}
+
+inline void printMicroResults(const vector<MicroResult>& results,ostream& out) {
+    out<<left<<setw(24)<<"benchmark"<<right
+       <<setw(12)<<"median"<<setw(12)<<"p10"<<setw(12)<<"p90"<<setw(12)<<"p99"
+       <<"   ns/op\n";
+    for (auto& r:results)
+        out<<left<<setw(24)<<r.name<<right<<fixed<<setprecision(1)
+           <<setw(12)<<r.median<<setw(12)<<r.p10<<setw(12)<<r.p90<<setw(12)<<r.p99<<"\n";
+}
+
+inline void printMicroResultsJson(const vector<MicroResult>& results,ostream& out) {
+    out<<"{\n  \"unit\": \"ns/op\",\n  \"benchmarks\": [\n";
+    for (size_t i=0;i<results.size();i++) {
+        const MicroResult& r=results[i];
+        out<<fixed<<setprecision(2)
+           <<"    {\"name\": \""<<r.name<<"\", \"median\": "<<r.median
+           <<", \"p10\": "<<r.p10<<", \"p90\": "<<r.p90<<", \"p99\": "<<r.p99
+           <<", \"min\": "<<r.minimum<<", \"samples\": "<<r.samples
+           <<", \"iterations\": "<<r.iterations<<"}"<<(i+1<results.size()?",":"")<<"\n";
+    }
+    out<<"  ]\n}\n";
+}
+
+#endif // CHESS_MICROBENCH_H
@@ -0,0 +1,467 @@
+#ifndef CHESS_SEARCH_H
+#define CHESS_SEARCH_H
+
+#include "chess_engine.h"
+#include "chess_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+// ================= EVALUATION =================
+// Material plus piece-square tables; the tables and the kernel that sums
+// them live in chess_kernels.h. Score in centipawns from the side to move's point of view.
+inline int evaluate(ChessGame& game) {
+    int score=kernels().evaluate(game.bitboards());
+    return game.sideToMove()==WHITE?score:-score;
+}
+
+// The same sum for backends without bitboards, square by square.
+template<class Board>
+inline int evaluate(BasicChessGame<Board>& game) {
+    int score=0;
+    for (int sq=0;sq<64;sq++) {
+        Piece p=game.pieceAt(sq/8,sq%8);
+        if (p.type==EMPTY) continue;
+        int v=PIECE_VALUE[p.type]+PST[p.type][p.color==WHITE?sq:sq^56];    // black reads mirrored rows
+        score+=p.color==WHITE?v:-v;
+    }
+    return game.sideToMove()==WHITE?score:-score;
+}
+
+// ================= TRANSPOSITION TABLE =================
+enum BoundType { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+
+struct TTEntry {
+    uint64_t key;
+    int16_t score;
+    uint16_t move;      // packMove()
+    int8_t depth;
+    uint8_t bound;
+};
+
+class TranspositionTable {
+private:
+    vector<TTEntry> table;
+    size_t mask;
+    MemoryAccount mem{MEM_HASH};
+
+public:
+    TranspositionTable(int megabytes=16) { resize(megabytes); }
+
+    void resize(int megabytes) {
+        size_t n=1;
+        while (n*2*sizeof(TTEntry)<=(size_t)megabytes*1024*1024) n*=2;
+        table.assign(n,TTEntry());
+        table.shrink_to_fit();
+        mask=n-1;
+        mem.set(bytes());
+        clear();
+    }
+
+    void clear() {
+        for (auto& e:table) { e.key=0; e.score=0; e.move=0; e.depth=0; e.bound=BOUND_NONE; }
+    }
+
+    bool probe(uint64_t key,TTEntry &e) {
+        STAT_INC(STAT_HASH_PROBES);
+        e=table[key&mask];
+        if (e.bound==BOUND_NONE || e.key!=key) return false;
+        STAT_INC(STAT_HASH_HITS);
+        return true;
+    }
+
+    // depth-preferred, but always replace stale keys
+    void store(uint64_t key,int score,uint16_t move,int depth,int bound) {
+        TTEntry& e=table[key&mask];
+        if (e.key==key && e.depth>depth && bound!=BOUND_EXACT) return;
+        if (e.key==key && move==0) move=e.move;
+        e.key=key; e.score=int16_t(score); e.move=move;
+        e.depth=int8_t(depth); e.bound=uint8_t(bound);
+    }
+
+    size_t bytes() { return table.size()*sizeof(TTEntry); }
+};
+
+// ================= SEARCH =================
+static const int MATE_SCORE=32000;
+static const int INF_SCORE=32500;
+static const int MAX_PLY=64;
+
+struct SearchLimits {
+    int depth;          // 0 = unlimited
+    uint64_t nodes;     // 0 = unlimited
+    int64_t movetime;   // milliseconds, 0 = unlimited
+    SearchLimits() : depth(0), nodes(0), movetime(0) {}
+};
+
+struct SearchInfo {
+    int depth;
+    int score;
+    Move best;
+    uint64_t nodes;
+    int64_t elapsed;    // milliseconds since search start
+};
+
+// ---------- tree shape (analysis mode) ----------
+// Per-iteration counters filled in when a SearchShape is attached to the
+// searcher; runs over several positions accumulate into the same rows.
+static const int SHAPE_DEPTHS=32;
+
+struct ShapeIteration {
+    uint64_t nodes, qnodes;             // alpha-beta and quiescence nodes
+    uint64_t cutoffs, firstMoveCutoffs;
+    uint64_t reductions, reSearches;    // LMR applied / failed high and re-searched
+    uint64_t pvsReSearches;             // null-window fail-high, full-window re-search
+    uint64_t ttProbes[SHAPE_DEPTHS], ttHits[SHAPE_DEPTHS];   // by remaining depth
+    ShapeIteration() { memset(this,0,sizeof(*this)); }
+};
+
+struct SearchShape {
+    vector<ShapeIteration> iterations;  // [depth-1]
+};
+
+// ================= TIME MANAGEMENT =================
+// Budget for one move from the mover's clock: an even share of the time left
+// for the remaining moves plus most of the increment, capped so a move never
+// eats more than a third of the clock and a small margin is always kept.
+inline int64_t allocateTime(int64_t remaining,int64_t increment,int movesToGo) {
+    int mtg=movesToGo>0?min(movesToGo,40):30;
+    int64_t budget=remaining/mtg+increment*3/4;
+    budget=min(budget,remaining/3+increment);
+    budget=min(budget,remaining-50);
+    budget=max<int64_t>(budget,1);
+    traceInstant("time","allocate","budget_ms",budget,"remaining_ms",remaining);
+    return budget;
+}
+
+// Iterative-deepening alpha-beta over a game the searcher borrows for the
+// duration of search(); moves are made with applyMove()/unapplyMove() so the
+// game's undo/redo history is left untouched. Game is a BasicChessGame; the
+// engine uses Searcher, over ChessGame.
+template<class Game>
+class BasicSearcher {
+private:
+    Game& game;
+    TranspositionTable tt;
+    SearchLimits limits;
+    chrono::steady_clock::time_point start;
+    uint64_t nodes;
+    bool stopped;
+    Move killers[MAX_PLY][2];           // a8a8 (all zero) when empty; never a legal move
+    int history[3][64][64];
+    vector<uint64_t> path;
+    Move rootBest;
+    int rootDepth;
+    SearchShape* shape;
+    ShapeIteration* shapeIt;            // current iteration's row, or null
+
+    int64_t elapsed() {
+        return chrono::duration_cast<chrono::milliseconds>(
+            chrono::steady_clock::now()-start).count();
+    }
+
+    void checkLimits() {
+        if (limits.nodes && nodes>=limits.nodes) stopped=true;
+        if (limits.movetime && (nodes&63)==0 && elapsed()>=limits.movetime) stopped=true;
+    }
+
+    // Every field set explicitly rather than relying on Move()'s defaults:
+    // scoreMoves() compares killers before any have been stored.
+    void clearKillers() {
+        for (auto& k:killers)
+            for (Move& m:k) {
+                m.fromRow=m.fromCol=m.toRow=m.toCol=0;
+                m.promotion=EMPTY;
+                m.isEnPassant=m.isCastling=false;
+            }
+    }
+
+    static bool sameMove(const Move& a,const Move& b) {
+        return a.fromRow==b.fromRow && a.fromCol==b.fromCol &&
+               a.toRow==b.toRow && a.toCol==b.toCol && a.promotion==b.promotion;
+    }
+
+    bool isCapture(const Move& m) {
+        return m.isEnPassant || game.pieceAt(m.toRow,m.toCol).type!=EMPTY;
+    }
+
+    bool isRepetition() {
+        uint64_t h=path.back();
+        int limit=(int)path.size()-1-game.halfMoves();
+        for (int i=(int)path.size()-3;i>=0 && i>=limit;i-=2)
+            if (path[i]==h) return true;
+        return false;
+    }
+
+    // TT move, then MVV-LVA captures and promotions, killers, history.
+    void scoreMoves(const vector<Move>& moves,vector<int>& scores,uint16_t ttMove,int ply) {
+        scores.resize(moves.size());
+        for (size_t i=0;i<moves.size();i++) {
+            const Move& m=moves[i];
+            int s;
+            if (ttMove && packMove(m)==ttMove) s=1000000;
+            else if (isCapture(m) || m.promotion!=EMPTY) {
+                PieceType victim=m.isEnPassant?PAWN:game.pieceAt(m.toRow,m.toCol).type;
+                s=500000+PIECE_VALUE[victim]*10-PIECE_VALUE[game.pieceAt(m.fromRow,m.fromCol).type]/10
+                  +PIECE_VALUE[m.promotion];
+            }
+            else if (ply<MAX_PLY && sameMove(m,killers[ply][0])) s=400000;
+            else if (ply<MAX_PLY && sameMove(m,killers[ply][1])) s=399000;
+            else s=history[game.sideToMove()][m.fromRow*8+m.fromCol][m.toRow*8+m.toCol];
+            scores[i]=s;
+        }
+    }
+
+    static void pickMove(vector<Move>& moves,vector<int>& scores,size_t i) {
+        size_t best=i;
+        for (size_t j=i+1;j<moves.size();j++)
+            if (scores[j]>scores[best]) best=j;
+        swap(moves[i],moves[best]);
+        swap(scores[i],scores[best]);
+    }
+
+    // Captures and queen promotions, plus quiet checks on the first
+    // quiescence ply. In check there is no stand-pat and every evasion is
+    // searched; the caller knows from givesCheck() whether that is the case.
+    int quiesce(int alpha,int beta,int ply,int qply,bool inCheck) {
+        nodes++;
+        STAT_INC(STAT_QNODES);
+        if (shapeIt) shapeIt->qnodes++;
+        checkLimits();
+        if (stopped) return 0;
+
+        if (ply>=MAX_PLY-1) return evaluate(game);
+        if (!inCheck) {
+            int standPat=evaluate(game);
+            if (standPat>=beta) return standPat;
+            if (standPat>alpha) alpha=standPat;
+        }
+
+        vector<Move> moves=game.getLegalMoves(game.sideToMove());
+        if (inCheck && moves.empty()) return -MATE_SCORE+ply;
+        typename Game::CheckInfo ci=game.checkInfo();
+        vector<Move> tactical;
+        for (auto& m:moves)
+            if (inCheck || isCapture(m) || m.promotion==QUEEN || (qply==0 && game.givesCheck(m,ci)))
+                tactical.push_back(m);
+        vector<int> scores;
+        scoreMoves(tactical,scores,0,MAX_PLY);
+
+        for (size_t i=0;i<tactical.size();i++) {
+            pickMove(tactical,scores,i);
+            bool check=game.givesCheck(tactical[i],ci);
+            typename Game::UndoInfo u;
+            game.applyMove(tactical[i],u);
+            int score=-quiesce(-beta,-alpha,ply+1,qply+1,check);
+            game.unapplyMove(tactical[i],u);
+            if (stopped) return 0;
+            if (score>=beta) return score;
+            if (score>alpha) alpha=score;
+        }
+        return alpha;
+    }
+
+    int alphaBeta(int depth,int alpha,int beta,int ply) {
+        if (ply>0 && (game.halfMoves()>=100 || isRepetition())) return 0;
+        if (depth<=0) return quiesce(alpha,beta,ply,0,false);   // checks are extended, see searchChild
+        nodes++;
+        if (shapeIt) shapeIt->nodes++;
+        checkLimits();
+        if (stopped) return 0;
+
+        Color us=game.sideToMove();
+        bool inCheck=game.isInCheck(us);
+
+        uint64_t key=path.back();
+        TTEntry e;
+        uint16_t ttMove=0;
+        bool ttHit=tt.probe(key,e);
+        if (shapeIt) {
+            int d=min(depth,SHAPE_DEPTHS-1);
+            shapeIt->ttProbes[d]++;
+            if (ttHit) shapeIt->ttHits[d]++;
+        }
+        if (ttHit) {
+            ttMove=e.move;
+            int s=e.score;
+            if (s>MATE_SCORE-MAX_PLY) s-=ply;
+            else if (s<-MATE_SCORE+MAX_PLY) s+=ply;
+            if (ply>0 && e.depth>=depth &&
+                (e.bound==BOUND_EXACT ||
+                 (e.bound==BOUND_LOWER && s>=beta) ||
+                 (e.bound==BOUND_UPPER && s<=alpha)))
+                return s;
+        }
+
+        int bestScore=-INF_SCORE, origAlpha=alpha;
+        Move best;
+        // One child, PVS with late move reductions for quiet moves; i is its
+        // place in the move order. Checking moves are extended by a ply and
+        // never reduced.
+        typename Game::CheckInfo ci=game.checkInfo();
+        auto searchChild=[&](const Move& m,size_t i,bool quiet) {
+            bool check=game.givesCheck(m,ci);
+            int newDepth=depth-1+(check?1:0);
+            typename Game::UndoInfo u;
+            game.applyMove(m,u);
+            path.push_back(game.positionHash());
+            int score;
+            if (i==0) score=-alphaBeta(newDepth,-beta,-alpha,ply+1);
+            else {
+                // late move reductions for quiet moves, verified on fail-high
+                int r=(depth>=3 && i>=3 && quiet && !inCheck && !check)?1:0;
+                if (r && shapeIt) shapeIt->reductions++;
+                score=-alphaBeta(newDepth-r,-alpha-1,-alpha,ply+1);
+                if (score>alpha && r) {
+                    if (shapeIt) shapeIt->reSearches++;
+                    score=-alphaBeta(newDepth,-alpha-1,-alpha,ply+1);
+                }
+                if (score>alpha && score<beta) {
+                    if (shapeIt) shapeIt->pvsReSearches++;
+                    score=-alphaBeta(newDepth,-beta,-alpha,ply+1);
+                }
+            }
+            path.pop_back();
+            game.unapplyMove(m,u);
+            return score;
+        };
+        // Bookkeeping for a searched child; true on a beta cutoff.
+        auto accept=[&](const Move& m,size_t i,bool quiet,int score) {
+            if (score>bestScore) {
+                bestScore=score;
+                best=m;
+                if (ply==0) rootBest=m;
+            }
+            if (score>alpha) alpha=score;
+            if (alpha<beta) return false;
+            STAT_CUTOFF_AT(i);
+            if (shapeIt) {
+                shapeIt->cutoffs++;
+                if (i==0) shapeIt->firstMoveCutoffs++;
+            }
+            if (quiet) {
+                if (!sameMove(m,killers[ply][0])) {
+                    killers[ply][1]=killers[ply][0];
+                    killers[ply][0]=m;
+                }
+                history[us][m.fromRow*8+m.fromCol][m.toRow*8+m.toCol]+=depth*depth;
+            }
+            return true;
+        };
+
+        // The TT move is checked with isLegal() and searched before the move
+        // list is built; when it cuts off, the node never generates moves.
+        Move hashMove;
+        bool hashMoveFirst=ttMove && ply<MAX_PLY-1 && game.unpackLegal(ttMove,hashMove);
+        bool cutoff=false;
+        if (hashMoveFirst) {
+            bool quiet=!isCapture(hashMove) && hashMove.promotion==EMPTY;
+            int score=searchChild(hashMove,0,quiet);
+            if (stopped) return 0;
+            cutoff=accept(hashMove,0,quiet,score);
+        }
+
+        if (!cutoff) {
+            vector<Move> moves=game.getLegalMoves(us);
+            if (moves.empty()) return inCheck?-MATE_SCORE+ply:0;
+            if (ply>=MAX_PLY-1) return evaluate(game);
+            if (!hashMoveFirst) best=moves[0];
+
+            vector<int> scores;
+            scoreMoves(moves,scores,ttMove,ply);
+            for (size_t i=0;i<moves.size();i++) {
+                pickMove(moves,scores,i);
+                const Move& m=moves[i];
+                if (hashMoveFirst && packMove(m)==ttMove) continue;     // searched above
+                bool quiet=!isCapture(m) && m.promotion==EMPTY;
+                int score=searchChild(m,i,quiet);
+                if (stopped) return 0;
+                if (accept(m,i,quiet,score)) break;
+            }
+        }
+
+        int stored=bestScore;
+        if (stored>MATE_SCORE-MAX_PLY) stored+=ply;
+        else if (stored<-MATE_SCORE+MAX_PLY) stored-=ply;
+        int bound=bestScore>=beta?BOUND_LOWER:(alpha>origAlpha?BOUND_EXACT:BOUND_UPPER);
+        tt.store(key,stored,packMove(best),depth,bound);
+        return bestScore;
+    }
+
+public:
+    // Called after every completed iteration.
+    function<void(const SearchInfo&)> onIteration;
+
+    BasicSearcher(Game& g,int hashMb=16) : game(g), tt(hashMb), nodes(0), stopped(false), rootDepth(0),
+        shape(nullptr), shapeIt(nullptr) {
+        clear();
+    }
+
+    // Forget everything learned from previous searches (new game).
+    void clear() {
+        tt.clear();
+        clearKillers();
+        for (auto& c:history) for (auto& f:c) for (auto& t:f) t=0;
+    }
+
+    SearchInfo search(const SearchLimits& lim) {
+        TraceSpan span("search","search");
+        limits=lim;
+        start=chrono::steady_clock::now();
+        nodes=0;
+        stopped=false;
+        clearKillers();
+        path.assign(1,game.positionHash());
+
+        SearchInfo info;
+        info.depth=0; info.score=0; info.nodes=0; info.elapsed=0;
+        vector<Move> rootMoves=game.getLegalMoves(game.sideToMove());
+        if (rootMoves.empty()) return info;
+        info.best=rootMoves[0];
+
+        int maxDepth=limits.depth>0?min(limits.depth,MAX_PLY-1):MAX_PLY-1;
+        for (rootDepth=1;rootDepth<=maxDepth;rootDepth++) {
+            TraceSpan iteration("search","iteration");
+            iteration.arg(0,"depth",rootDepth);
+            if (shape) {
+                if ((int)shape->iterations.size()<rootDepth) shape->iterations.resize(rootDepth);
+                shapeIt=&shape->iterations[rootDepth-1];
+            }
+            int score=alphaBeta(rootDepth,-INF_SCORE,INF_SCORE,0);
+            iteration.arg(1,"nodes",(int64_t)nodes);
+            if (stopped) {
+                traceInstant("time","stop","elapsed_ms",elapsed(),"depth",rootDepth);
+                break;
+            }
+            info.depth=rootDepth;
+            info.score=score;
+            info.best=rootBest;
+            info.nodes=nodes;
+            info.elapsed=elapsed();
+            if (onIteration) onIteration(info);
+            if (abs(score)>MATE_SCORE-MAX_PLY) break;
+            if (limits.movetime && info.elapsed*2>=limits.movetime) {
+                // the next iteration would not finish in the time left
+                traceInstant("time","no next iteration","elapsed_ms",info.elapsed,"movetime_ms",limits.movetime);
+                break;
+            }
+        }
+        shapeIt=nullptr;
+        info.nodes=nodes;
+        info.elapsed=elapsed();
+        span.arg(0,"depth",info.depth);
+        span.arg(1,"nodes",(int64_t)nodes);
+        return info;
+    }
+
+    uint64_t nodeCount() { return nodes; }
+    // Attach (or detach with nullptr) tree-shape recording.
+    void recordShape(SearchShape* s) { shape=s; }
+    TranspositionTable& hashTable() { return tt; }
+};
+
+typedef BasicSearcher<ChessGame> Searcher;
+
+#endif // CHESS_SEARCH_H
@@ -0,0 +1,212 @@
+#ifndef CHESS_SELFPLAY_H
+#define CHESS_SELFPLAY_H
+
+#include "chess_engine.h"
+#include "chess_search.h"
+#include "chess_bench.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+
+// ================= PACKED TRAINING RECORD =================
+// One position per 32-byte record, appended to the output file as-is.
+// Squares are numbered row*8+col (row 0 = rank 8).
+struct PackedPosition {
+    uint64_t occupancy;     // packPlacement(): bit per occupied square
+    uint8_t pieces[16];     // and a 4-bit code per occupied square
+    int16_t score;          // search score, side to move's view (centipawns)
+    uint8_t flags;          // bit0 black to move, bits1-4 castling rights
+    uint8_t epFile;         // 0 = none, otherwise file+1
+    int8_t result;          // game result, white's view: 1, 0, -1
+    uint8_t halfMoveClock;
+    uint16_t ply;           // ply of the game the position was played at
+};
+static_assert(sizeof(PackedPosition)==32,"PackedPosition must stay 32 bytes");
+
+inline PackedPosition packPosition(ChessGame& game,int score,int ply) {
+    PackedPosition p;
+    memset(&p,0,sizeof(p));
+    packPlacement([&](int sq) { return game.pieceAt(sq/8,sq%8); },p.occupancy,p.pieces);
+    p.score=int16_t(max(-32767,min(32767,score)));
+    p.flags=uint8_t((game.sideToMove()==BLACK?1:0)|(game.castlingRights()<<1));
+    p.epFile=uint8_t(game.enPassantFile()+1);
+    p.halfMoveClock=uint8_t(min(255,game.halfMoves()));
+    p.ply=uint16_t(ply);
+    return p;
+}
+
+inline string packedToFen(const PackedPosition& p) {
+    const char* letters=" PNBRQK";
+    char cell[64]={0};
+    unpackPlacement(p.occupancy,p.pieces,[&](int sq,Piece pc) {
+        cell[sq]=pc.color==BLACK?char(tolower(letters[pc.type])):letters[pc.type];
+    });
+    string fen;
+    for (int r=0;r<8;r++) {
+        int empty=0;
+        for (int c=0;c<8;c++) {
+            char ch=cell[r*8+c];
+            if (!ch) { empty++; continue; }
+            if (empty) { fen+=char('0'+empty); empty=0; }
+            fen+=ch;
+        }
+        if (empty) fen+=char('0'+empty);
+        if (r<7) fen+='/';
+    }
+    fen+=(p.flags&1)?" b ":" w ";
+    int cr=p.flags>>1;
+    string castling;
+    if (cr&1) castling+='K';
+    if (cr&2) castling+='Q';
+    if (cr&4) castling+='k';
+    if (cr&8) castling+='q';
+    fen+=castling.empty()?"-":castling;
+    if (p.epFile) {
+        fen+=' ';
+        fen+=char('a'+p.epFile-1);
+        fen+=(p.flags&1)?'3':'6';
+    } else fen+=" -";
+    fen+=" "+to_string(p.halfMoveClock)+" "+to_string(p.ply/2+1);
+    return fen;
+}
+
+// ================= SELF-PLAY =================
+struct SelfPlayOptions {
+    string output;
+    int games=1000;
+    int threads=1;
+    SearchLimits limits;
+    int randomPlies=8;      // uniformly random opening moves
+    int maxPlies=400;       // adjudicated as a draw beyond this
+    uint64_t seed=1;
+};
+
+// Plays one game and returns its records with the result filled in.
+// Moves are made with applyMove() so no undo history is kept.
+inline void playSelfPlayGame(ChessGame& game,Searcher& searcher,const SelfPlayOptions& opt,
+                             mt19937_64& rng,vector<PackedPosition>& out) {
+    out.clear();
+    int result=0;
+    for (;;) {                          // retry openings that end the game early
+        game.loadFen(START_FEN);
+        bool alive=true;
+        for (int i=0;i<opt.randomPlies && alive;i++) {
+            vector<Move> moves=game.getLegalMoves(game.sideToMove());
+            if (moves.empty()) { alive=false; break; }
+            ChessGame::UndoInfo u;
+            game.applyMove(moves[rng()%moves.size()],u);
+        }
+        if (alive && game.hasLegalMove()) break;
+    }
+    searcher.clear();
+
+    vector<uint64_t> seen(1,game.positionHash());
+    for (int ply=opt.randomPlies;;ply++) {
+        Color us=game.sideToMove();
+        vector<Move> moves=game.getLegalMoves(us);
+        if (moves.empty()) {
+            result=game.isInCheck(us)?(us==WHITE?-1:1):0;
+            break;
+        }
+        if (game.halfMoves()>=100 || game.insufficientMaterial() || ply>=opt.maxPlies ||
+            count(seen.begin(),seen.end(),seen.back())>=3) {
+            result=0;
+            break;
+        }
+        SearchInfo info=searcher.search(opt.limits);
+        out.push_back(packPosition(game,info.score,ply));
+        ChessGame::UndoInfo u;
+        game.applyMove(info.best,u);
+        seen.push_back(game.positionHash());
+    }
+    for (auto& p:out) p.result=int8_t(result);
+}
+
+inline int runSelfPlay(const SelfPlayOptions& opt) {
+    FILE* f=fopen(opt.output.c_str(),"ab");
+    if (!f) {
+        cerr<<"cannot open "<<opt.output<<" for append\n";
+        return 1;
+    }
+    mutex writeLock;
+    atomic<int> next(0);
+    atomic<uint64_t> positions(0);
+    atomic<int> finished(0);
+    atomic<bool> writeFailed(false);    // disk full etc.: stop, report failure
+    auto t0=chrono::steady_clock::now();
+
+    auto worker=[&]() {
+        ChessGame game;
+        Searcher searcher(game);
+        vector<PackedPosition> records;
+        int g;
+        while (!writeFailed && (g=next++)<opt.games) {
+            mt19937_64 rng(opt.seed*0x9E3779B97F4A7C15ULL+g);
+            playSelfPlayGame(game,searcher,opt,rng,records);
+            lock_guard<mutex> lock(writeLock);
+            if (writeFailed) break;
+            if (fwrite(records.data(),sizeof(PackedPosition),records.size(),f)!=records.size() || fflush(f)!=0) {
+                writeFailed=true;
+                break;
+            }
+            positions+=records.size();
+            int done=++finished;
+            if (done%10==0 || done==opt.games) {
+                double s=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+                cerr<<"games "<<done<<"/"<<opt.games<<"  positions "<<positions
+                    <<"  "<<(uint64_t)(positions/max(s,1e-3))<<" pos/s\n";
+            }
+        }
+    };
+    vector<thread> pool;
+    for (int t=0;t<max(1,opt.threads);t++) pool.emplace_back(worker);
+    for (auto& t:pool) t.join();
+    if (fclose(f)!=0) writeFailed=true;
+    if (writeFailed) {
+        cerr<<"cannot write "<<opt.output<<" after "<<positions<<" positions\n";
+        return 1;
+    }
+
+    double s=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+    cout<<"games "<<opt.games<<", positions "<<positions<<", "
+        <<(uint64_t)(positions/max(s,1e-3))<<" positions/s, "<<opt.output<<"\n";
+    return 0;
+}
+
+//   selfplay <out.bin> [games=N] [threads=N] [nodes=N|depth=D|movetime=ms]
+//            [random=plies] [maxply=N] [seed=N]
+inline int selfplayMain(const vector<string>& args) {
+    if (args.empty()) {
+        cerr<<"usage: selfplay <out.bin> [games=N] [threads=N] [nodes=N|depth=D]"
+              " [random=plies] [maxply=N] [seed=N]\n";
+        return 1;
+    }
+    SelfPlayOptions opt;
+    opt.output=args[0];
+    opt.threads=max(1u,thread::hardware_concurrency());
+    opt.limits.depth=4;
+    for (size_t i=1;i<args.size();i++) {
+        const string& a=args[i];
+        size_t eq=a.find('=');
+        string key=a.substr(0,eq), val=eq==string::npos?"":a.substr(eq+1);
+        if (key=="games") opt.games=atoi(val.c_str());
+        else if (key=="threads") opt.threads=atoi(val.c_str());
+        else if (key=="random") opt.randomPlies=atoi(val.c_str());
+        else if (key=="maxply") opt.maxPlies=atoi(val.c_str());
+        else if (key=="seed") opt.seed=strtoull(val.c_str(),nullptr,10);
+        else if (key=="nodes" || key=="depth" || key=="movetime") {
+            opt.limits=SearchLimits();
+            parseSearchLimit(a,opt.limits);
+        } else {
+            cerr<<"unknown option "<<a<<"\n";
+            return 1;
+        }
+    }
+    return runSelfPlay(opt);
+}
+
+#endif // CHESS_SELFPLAY_H
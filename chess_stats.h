@@ -0,0 +1,110 @@
+#ifndef CHESS_STATS_H
+#define CHESS_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// ================= HOT-PATH COUNTERS =================
+// Compiled in with -DCHESS_STATS (cmake -DCHESS_STATS=ON); otherwise the
+// STAT_* macros expand to nothing and the hot paths are unchanged. Each
+// thread bumps its own cache-line aligned block with relaxed load+store (no
+// locked instructions); STATS sums the live blocks and those of threads that
+// have already exited.
+enum StatId {
+    STAT_MOVEGEN,           // getLegalMoves() calls
+    STAT_LEGALITY,          // testMove() calls
+    STAT_ATTACKS,           // isSquareAttacked() calls
+    STAT_HASH_PROBES,
+    STAT_HASH_HITS,
+    STAT_QNODES,            // quiescence nodes
+    STAT_CUTOFF,            // beta cutoffs by move index: 1..7, 8+
+    STAT_COUNT=STAT_CUTOFF+8
+};
+
+static const char* const STAT_NAMES[STAT_CUTOFF]={
+    "movegen", "legality", "attacks", "hash_probes", "hash_hits", "qnodes"
+};
+
+struct alignas(64) StatBlock {
+    std::atomic<uint64_t> v[STAT_COUNT];
+    StatBlock() { for (auto& x:v) x.store(0,std::memory_order_relaxed); }
+};
+
+class StatRegistry {
+private:
+    std::mutex lock;
+    std::vector<StatBlock*> live;
+    uint64_t retired[STAT_COUNT]={};
+
+public:
+    void add(StatBlock* b) {
+        std::lock_guard<std::mutex> g(lock);
+        live.push_back(b);
+    }
+
+    void remove(StatBlock* b) {
+        std::lock_guard<std::mutex> g(lock);
+        for (int i=0;i<STAT_COUNT;i++) retired[i]+=b->v[i].load(std::memory_order_relaxed);
+        for (size_t i=0;i<live.size();i++)
+            if (live[i]==b) { live[i]=live.back(); live.pop_back(); break; }
+    }
+
+    void snapshot(uint64_t out[STAT_COUNT]) {
+        std::lock_guard<std::mutex> g(lock);
+        for (int i=0;i<STAT_COUNT;i++) out[i]=retired[i];
+        for (auto b:live)
+            for (int i=0;i<STAT_COUNT;i++) out[i]+=b->v[i].load(std::memory_order_relaxed);
+    }
+
+    // Meant for quiet moments (between commands): a thread bumping a counter
+    // concurrently may write its old value back.
+    void reset() {
+        std::lock_guard<std::mutex> g(lock);
+        for (auto& x:retired) x=0;
+        for (auto b:live)
+            for (auto& x:b->v) x.store(0,std::memory_order_relaxed);
+    }
+};
+
+inline StatRegistry& statRegistry() {
+    static StatRegistry registry;
+    return registry;
+}
+
+struct ThreadStatBlock {
+    StatBlock block;
+    ThreadStatBlock() { statRegistry().add(&block); }
+    ~ThreadStatBlock() { statRegistry().remove(&block); }
+};
+
+inline void statBump(int id) {
+    thread_local ThreadStatBlock t;
+    std::atomic<uint64_t>& c=t.block.v[id];
+    c.store(c.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+}
+
+#ifdef CHESS_STATS
+#define STAT_INC(id) statBump(id)
+#define STAT_CUTOFF_AT(index) statBump(STAT_CUTOFF+((index)<7?int(index):7))
+#else
+#define STAT_INC(id) ((void)0)
+#define STAT_CUTOFF_AT(index) ((void)0)
+#endif
+
+inline void printStats(std::ostream& out) {
+#ifdef CHESS_STATS
+    uint64_t s[STAT_COUNT];
+    statRegistry().snapshot(s);
+    for (int i=0;i<STAT_CUTOFF;i++) out<<"STATS "<<STAT_NAMES[i]<<" "<<s[i]<<"\n";
+    out<<"STATS cutoffs";
+    for (int i=0;i<8;i++) out<<" "<<i+1<<(i==7?"+":"")<<":"<<s[STAT_CUTOFF+i];
+    out<<"\n";
+#else
+    out<<"STATS disabled (rebuild with -DCHESS_STATS)\n";
+#endif
+}
+
+#endif // CHESS_STATS_H
@@ -0,0 +1,175 @@
+#ifndef CHESS_TRACE_H
+#define CHESS_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ================= CHROME TRACE =================
+// Optional trace of commands, searches, iterations and time-manager
+// decisions in Chrome trace-event JSON (chrome://tracing, Perfetto). Each
+// thread appends to its own buffer without locking; the buffers are written
+// out by flush() once the worker threads have been joined. When tracing is
+// off every hook is one relaxed load and a branch.
+struct TraceEvent {
+    char name[32];
+    const char* category;
+    char phase;                 // 'X' complete span, 'i' instant
+    uint64_t ts, dur;           // nanoseconds since start()
+    const char* argName[2];
+    int64_t argValue[2];
+};
+
+class TraceRecorder {
+private:
+    static const size_t MAX_EVENTS_PER_THREAD=1<<20;
+
+    struct Buffer {
+        int tid;
+        std::vector<TraceEvent> events;
+        uint64_t dropped;
+    };
+
+    std::atomic<bool> on{false};
+    std::mutex lock;                            // guards buffers (registration only)
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::string path;
+    std::chrono::steady_clock::time_point origin;
+
+    Buffer& local() {
+        thread_local Buffer* b=nullptr;
+        if (!b) {
+            std::lock_guard<std::mutex> g(lock);
+            buffers.emplace_back(new Buffer());
+            b=buffers.back().get();
+            b->tid=(int)buffers.size();
+            b->dropped=0;
+            b->events.reserve(4096);
+        }
+        return *b;
+    }
+
+    static void writeEscaped(FILE* f,const char* s) {
+        for (;*s;s++) {
+            if (*s=='"' || *s=='\\') fprintf(f,"\\%c",*s);
+            else if ((unsigned char)*s<0x20) fprintf(f,"\\u%04x",*s);
+            else fputc(*s,f);
+        }
+    }
+
+public:
+    bool enabled() const { return on.load(std::memory_order_relaxed); }
+    const std::string& file() const { return path; }
+
+    void start(const std::string& file) {
+        path=file;
+        origin=std::chrono::steady_clock::now();
+        on.store(true,std::memory_order_relaxed);
+    }
+
+    uint64_t now() const {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now()-origin).count();
+    }
+
+    void add(const TraceEvent& e) {
+        Buffer& b=local();
+        if (b.events.size()<MAX_EVENTS_PER_THREAD) b.events.push_back(e);
+        else b.dropped++;
+    }
+
+    // Call after all traced threads have finished.
+    bool flush() {
+        on.store(false,std::memory_order_relaxed);
+        FILE* f=fopen(path.c_str(),"w");
+        if (!f) return false;
+        std::lock_guard<std::mutex> g(lock);
+        fprintf(f,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first=true;
+        for (auto& b:buffers) {
+            fprintf(f,"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                      "\"args\":{\"name\":\"thread %d\"}}",
+                    first?"":",\n",b->tid,b->tid);
+            first=false;
+            for (auto& e:b->events) {
+                fprintf(f,",\n{\"name\":\"");
+                writeEscaped(f,e.name);
+                fprintf(f,"\",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f",
+                        e.category,e.phase,b->tid,e.ts/1000.0);
+                if (e.phase=='X') fprintf(f,",\"dur\":%.3f",e.dur/1000.0);
+                else fprintf(f,",\"s\":\"t\"");
+                if (e.argName[0]) {
+                    fprintf(f,",\"args\":{\"%s\":%lld",e.argName[0],(long long)e.argValue[0]);
+                    if (e.argName[1]) fprintf(f,",\"%s\":%lld",e.argName[1],(long long)e.argValue[1]);
+                    fprintf(f,"}");
+                }
+                fprintf(f,"}");
+            }
+            if (b->dropped)
+                fprintf(f,",\n{\"name\":\"events dropped\",\"cat\":\"trace\",\"ph\":\"i\",\"s\":\"t\","
+                          "\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"count\":%llu}}",
+                        b->tid,now()/1000.0,(unsigned long long)b->dropped);
+        }
+        fprintf(f,"\n]}\n");
+        return fclose(f)==0;
+    }
+};
+
+inline TraceRecorder& tracer() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+inline void traceInit(TraceEvent& e,const char* category,const char* name,char phase) {
+    strncpy(e.name,name,sizeof(e.name)-1);
+    e.name[sizeof(e.name)-1]=0;
+    e.category=category;
+    e.phase=phase;
+    e.ts=tracer().now();
+    e.dur=0;
+    e.argName[0]=e.argName[1]=nullptr;
+    e.argValue[0]=e.argValue[1]=0;
+}
+
+// Span from construction to destruction; up to two integer arguments.
+class TraceSpan {
+private:
+    bool active;
+    TraceEvent e;
+
+public:
+    TraceSpan(const char* category,const char* name) : active(tracer().enabled()) {
+        if (active) traceInit(e,category,name,'X');
+    }
+    ~TraceSpan() {
+        if (!active) return;
+        e.dur=tracer().now()-e.ts;
+        tracer().add(e);
+    }
+    TraceSpan(const TraceSpan&)=delete;
+    TraceSpan& operator=(const TraceSpan&)=delete;
+
+    void arg(int slot,const char* name,int64_t value) {
+        e.argName[slot]=name;
+        e.argValue[slot]=value;
+    }
+};
+
+inline void traceInstant(const char* category,const char* name,
+                         const char* a0=nullptr,int64_t v0=0,
+                         const char* a1=nullptr,int64_t v1=0) {
+    if (!tracer().enabled()) return;
+    TraceEvent e;
+    traceInit(e,category,name,'i');
+    e.argName[0]=a0; e.argValue[0]=v0;
+    e.argName[1]=a1; e.argValue[1]=v1;
+    tracer().add(e);
+}
+
+#endif // CHESS_TRACE_H
@@ -0,0 +1,278 @@
+// Deduplicates and shuffles PackedPosition training files that do not fit
+// in memory.
+//
+//   dedup <in.bin> <out.bin> [--memory MB] [--tmp dir] [--seed N]
+//
+// Pass 1 hash-partitions the input into temporary files so every copy of a
+// position lands in the same partition. Pass 2 sorts each partition (as
+// sorted runs merged k-way if the partition is still larger than the memory
+// budget), keeps the first record of each position, and scatters survivors
+// into random shuffle buckets. Pass 3 shuffles each bucket in memory and
+// appends it to the output.
+#include "chess_selfplay.h"
+
+#include <cstdio>
+#include <queue>
+#include <random>
+
+// 64-bit file offsets, so inputs over 2 GB work where long is 32 bits.
+#ifdef _WIN32
+static int64_t fileTell(FILE* f) { return _ftelli64(f); }
+static int fileSeek(FILE* f,int64_t off,int whence) { return _fseeki64(f,off,whence); }
+#else
+static int64_t fileTell(FILE* f) { return (int64_t)ftello(f); }
+static int fileSeek(FILE* f,int64_t off,int whence) { return fseeko(f,(off_t)off,whence); }
+#endif
+
+// Positions are equal when placement, side, castling and en passant match;
+// score, result and clocks do not take part.
+static int compareKey(const PackedPosition& a,const PackedPosition& b) {
+    if (a.occupancy!=b.occupancy) return a.occupancy<b.occupancy?-1:1;
+    int c=memcmp(a.pieces,b.pieces,sizeof(a.pieces));
+    if (c) return c;
+    if (a.flags!=b.flags) return a.flags<b.flags?-1:1;
+    if (a.epFile!=b.epFile) return a.epFile<b.epFile?-1:1;
+    return 0;
+}
+
+static uint64_t hashKey(const PackedPosition& p) {
+    uint64_t h=p.occupancy*0x9E3779B97F4A7C15ULL;
+    uint64_t w[2];
+    memcpy(w,p.pieces,16);
+    h^=(w[0]+0xBF58476D1CE4E5B9ULL)*0x94D049BB133111EBULL;
+    h^=(h>>29)^((w[1]^uint64_t(p.flags)<<8^p.epFile)*0xBF58476D1CE4E5B9ULL);
+    return h^(h>>32);
+}
+
+// Buffered sequential reader over a temporary file.
+class RecordReader {
+private:
+    FILE* f;
+    vector<PackedPosition> buf;
+    size_t pos, len;
+
+public:
+    RecordReader(const string& path,size_t bufferRecords) : pos(0), len(0) {
+        f=fopen(path.c_str(),"rb");
+        buf.resize(max<size_t>(1,bufferRecords));
+    }
+    ~RecordReader() { if (f) fclose(f); }
+
+    bool ok() const { return f!=nullptr; }
+
+    bool next(PackedPosition& p) {
+        if (pos==len) {
+            if (!f) return false;
+            len=fread(buf.data(),sizeof(PackedPosition),buf.size(),f);
+            pos=0;
+            if (!len) return false;
+        }
+        p=buf[pos++];
+        return true;
+    }
+};
+
+// Per-file write buffers, so records scattered over many files go out in
+// blocks rather than one fwrite each.
+class BucketWriter {
+private:
+    vector<FILE*> files;
+    vector<vector<PackedPosition>> pending;
+    size_t limit;
+    bool failed;
+
+    void flush(size_t i) {
+        vector<PackedPosition>& v=pending[i];
+        if (!v.empty() && fwrite(v.data(),sizeof(PackedPosition),v.size(),files[i])!=v.size()) failed=true;
+        v.clear();
+    }
+
+public:
+    BucketWriter(size_t bufferRecords) : limit(max<size_t>(1,bufferRecords)), failed(false) {}
+    ~BucketWriter() { close(); }
+
+    bool open(const string& path) {
+        FILE* f=fopen(path.c_str(),"wb");
+        if (!f) return false;
+        files.push_back(f);
+        pending.emplace_back();
+        pending.back().reserve(limit);
+        return true;
+    }
+
+    void add(size_t i,const PackedPosition& p) {
+        pending[i].push_back(p);
+        if (pending[i].size()>=limit) flush(i);
+    }
+
+    // Flushes and closes everything; false if any write failed.
+    bool close() {
+        for (size_t i=0;i<files.size();i++) {
+            flush(i);
+            if (fclose(files[i])!=0) failed=true;
+        }
+        files.clear();
+        pending.clear();
+        return !failed;
+    }
+};
+
+static size_t remainingRecords(FILE* f) {
+    int64_t cur=fileTell(f);
+    fileSeek(f,0,SEEK_END);
+    int64_t end=fileTell(f);
+    fileSeek(f,cur,SEEK_SET);
+    return (size_t)((end-cur)/(int64_t)sizeof(PackedPosition));
+}
+
+// Reads up to max records, sizing the buffer by what is left in the file.
+static size_t readRecords(FILE* f,vector<PackedPosition>& v,size_t max) {
+    v.resize(min(max,remainingRecords(f)));
+    size_t n=fread(v.data(),sizeof(PackedPosition),v.size(),f);
+    v.resize(n);
+    return n;
+}
+
+int main(int argc, char** argv) {
+    if (argc<3) {
+        cerr<<"usage: dedup <in.bin> <out.bin> [--memory MB] [--tmp dir] [--seed N]\n";
+        return 1;
+    }
+    string input=argv[1], output=argv[2], tmpDir=".";
+    uint64_t memoryMb=1024, seed=1;
+    for (int i=3;i<argc;i++) {
+        string a=argv[i];
+        if (a=="--memory" && i+1<argc) memoryMb=strtoull(argv[++i],nullptr,10);
+        else if (a=="--tmp" && i+1<argc) tmpDir=argv[++i];
+        else if (a=="--seed" && i+1<argc) seed=strtoull(argv[++i],nullptr,10);
+    }
+    const size_t memRecords=max<uint64_t>(1024,memoryMb*1024*1024/sizeof(PackedPosition));
+
+    FILE* in=fopen(input.c_str(),"rb");
+    if (!in) { cerr<<"cannot open "<<input<<"\n"; return 1; }
+    fileSeek(in,0,SEEK_END);
+    uint64_t total=(uint64_t)fileTell(in)/sizeof(PackedPosition);
+    fileSeek(in,0,SEEK_SET);
+
+    // Budget: an eighth for the bucket write buffers; the rest is split
+    // between a sort chunk and stable_sort's scratch of up to the same size.
+    // Partitions are sized to one chunk.
+    const size_t bucketBudget=memRecords/8, sortRecords=(memRecords-bucketBudget)/2;
+    size_t parts=(size_t)max<uint64_t>(1,(total+sortRecords-1)/sortRecords);
+    string prefix=tmpDir+"/dedup_"+to_string((unsigned long long)chrono::steady_clock::now().time_since_epoch().count());
+    auto partName=[&](const char* kind,size_t i) { return prefix+"_"+kind+to_string(i)+".tmp"; };
+    // Every temporary file name handed out, removed again on failure.
+    vector<string> temps;
+    auto tempName=[&](const char* kind,size_t i) { temps.push_back(partName(kind,i)); return temps.back(); };
+    auto fail=[&](const string& what) {
+        cerr<<what<<"\n";
+        for (auto& t:temps) remove(t.c_str());
+        return 1;
+    };
+    const size_t bucketRecords=max<size_t>(64,bucketBudget/parts);
+    auto t0=chrono::steady_clock::now();
+
+    // ---------- PASS 1: hash partition ----------
+    {
+        BucketWriter out(bucketRecords);
+        for (size_t i=0;i<parts;i++)
+            if (!out.open(tempName("p",i))) { fclose(in); return fail("cannot create temporary file in "+tmpDir); }
+        vector<PackedPosition> chunk;
+        while (readRecords(in,chunk,sortRecords))
+            for (auto& p:chunk) out.add(hashKey(p)%parts,p);
+        fclose(in);
+        if (!out.close()) return fail("cannot write temporary files in "+tmpDir);
+    }
+
+    // ---------- PASS 2: sort, dedup, scatter ----------
+    mt19937_64 rng(seed);
+    BucketWriter buckets(bucketRecords);
+    for (size_t i=0;i<parts;i++)
+        if (!buckets.open(tempName("s",i))) return fail("cannot create temporary file in "+tmpDir);
+    uint64_t unique=0;
+    PackedPosition last;
+    bool haveLast=false;
+    auto emit=[&](const PackedPosition& p) {
+        if (haveLast && compareKey(p,last)==0) return;
+        last=p; haveLast=true; unique++;
+        buckets.add(rng()%parts,p);
+    };
+    auto byKey=[](const PackedPosition& a,const PackedPosition& b) { return compareKey(a,b)<0; };
+
+    for (size_t i=0;i<parts;i++) {
+        string name=partName("p",i);
+        FILE* f=fopen(name.c_str(),"rb");
+        if (!f) return fail("cannot reopen "+name);
+        vector<string> runs;
+        vector<PackedPosition> chunk;
+        haveLast=false;
+        while (readRecords(f,chunk,sortRecords)) {
+            stable_sort(chunk.begin(),chunk.end(),byKey);
+            if (runs.empty() && !remainingRecords(f)) {   // partition fits: no runs
+                for (auto& p:chunk) emit(p);
+                chunk.clear();
+                break;
+            }
+            string run=tempName("r",runs.size());
+            FILE* r=fopen(run.c_str(),"wb");
+            bool written=r && fwrite(chunk.data(),sizeof(PackedPosition),chunk.size(),r)==chunk.size();
+            if (r && fclose(r)!=0) written=false;
+            if (!written) { fclose(f); return fail("cannot write run file "+run); }
+            runs.push_back(run);
+        }
+        fclose(f);
+        remove(name.c_str());
+        if (runs.empty()) continue;
+
+        // k-way merge; ties resolved by run order so the first copy survives
+        size_t bufRecords=max<size_t>(64,sortRecords/runs.size());
+        vector<unique_ptr<RecordReader>> readers;
+        typedef pair<PackedPosition,size_t> Head;
+        auto later=[](const Head& a,const Head& b) {
+            int c=compareKey(a.first,b.first);
+            return c>0 || (c==0 && a.second>b.second);
+        };
+        priority_queue<Head,vector<Head>,decltype(later)> heap(later);
+        for (size_t r=0;r<runs.size();r++) {
+            readers.emplace_back(new RecordReader(runs[r],bufRecords));
+            if (!readers[r]->ok()) return fail("cannot reopen "+runs[r]);
+            PackedPosition p;
+            if (readers[r]->next(p)) heap.push(Head(p,r));
+        }
+        while (!heap.empty()) {
+            Head h=heap.top();
+            heap.pop();
+            emit(h.first);
+            PackedPosition p;
+            if (readers[h.second]->next(p)) heap.push(Head(p,h.second));
+        }
+        readers.clear();
+        for (auto& r:runs) remove(r.c_str());
+    }
+    if (!buckets.close()) return fail("cannot write temporary files in "+tmpDir);
+
+    // ---------- PASS 3: shuffle buckets into the output ----------
+    FILE* out=fopen(output.c_str(),"wb");
+    if (!out) return fail("cannot open "+output);
+    for (size_t i=0;i<parts;i++) {
+        string name=partName("s",i);
+        FILE* f=fopen(name.c_str(),"rb");
+        if (!f) { fclose(out); return fail("cannot reopen "+name); }
+        // a bucket holds about one partition's survivors, well inside the budget
+        vector<PackedPosition> all;
+        readRecords(f,all,remainingRecords(f));
+        fclose(f);
+        remove(name.c_str());
+        shuffle(all.begin(),all.end(),rng);
+        if (fwrite(all.data(),sizeof(PackedPosition),all.size(),out)!=all.size()) {
+            fclose(out);
+            return fail("cannot write "+output);
+        }
+    }
+    if (fclose(out)!=0) return fail("cannot write "+output);
+
+    double s=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+    cout<<"input "<<total<<", unique "<<unique<<", duplicates "<<total-unique
+        <<", partitions "<<parts<<", "<<fixed<<setprecision(1)<<s<<" s\n";
+    return 0;
+}
@@ -0,0 +1,258 @@
+// Regression tests beyond perft node totals (perft_suite): FEN limits, the
+// single-move predicates checked against the generator, the variation tree,
+// packed records and percentiles. Each check prints a line on failure; the
+// exit status is the number of failures. Registered with ctest as
+// `engine_tests`.
+//
+//   engine_tests
+#include "chess_engine.h"
+#include "chess_latency.h"
+#include "chess_perft.h"
+#include "chess_selfplay.h"
+
+static int failures=0;
+
+static void check(bool ok,const char* what) {
+    if (ok) return;
+    cout<<"FAIL "<<what<<"\n";
+    failures++;
+}
+
+// ---------- FEN limits ----------
+// A Checkpoint packs at most 32 pieces, so loadFen() must refuse more; the
+// move generator steps off the board from a back-rank pawn.
+static void testFenLimits() {
+    ChessGame game;
+    check(!game.loadFen("rnbqkbnr/pppppppp/p7/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"),"33 pieces rejected");
+    check(!game.loadFen("qqqqqqqq/qqqqqqqq/qqqqqqqq/8/8/QQQQQQQQ/QQQQQQQQ/QQQQKQQk w - - 0 1"),"50 pieces rejected");
+    check(!game.loadFen("k6k/8/8/8/8/8/8/4K3 w - - 0 1"),"two black kings rejected");
+    check(!game.loadFen("P7/8/8/8/8/8/8/k3K3 w - - 0 1"),"white pawn on rank 8 rejected");
+    check(!game.loadFen("4k3/8/8/8/8/8/8/p3K3 b - - 0 1"),"black pawn on rank 1 rejected");
+    check(!game.loadFen("4k3/8/8/8/8/8/8/P3K3 w - - 0 1"),"white pawn on rank 1 rejected");
+    check(game.positionHash()==ChessGame().positionHash(),"position kept after a rejected FEN");
+
+    // a full 32-piece board survives a checkpoint round trip
+    check(game.loadFen(START_FEN),"start position accepted");
+    static const char* const line[]={"g1f3","g8f6","f3g1","f6g8","g1f3","g8f6","f3g1","f6g8","e2e4"};
+    for (const char* t:line) {
+        Move u,a;
+        check(game.parseMove(t,u) && game.findLegalMove(u,a),"line move legal");
+        game.makeMove(a);
+    }
+    uint64_t h=game.positionHash();
+    check(game.goTo(0) && game.goTo(9) && game.positionHash()==h,"goTo through a 32-piece checkpoint");
+}
+
+// ---------- single-move predicates ----------
+// Calls f(game) at every node up to `depth` plies below the current position.
+template<class F> static void forEachNode(ChessGame& game,int depth,F f) {
+    f(game);
+    if (depth==0) return;
+    for (auto& m:game.getLegalMoves(game.sideToMove())) {
+        ChessGame::UndoInfo u;
+        game.applyMove(m,u);
+        forEachNode(game,depth-1,f);
+        game.unapplyMove(m,u);
+    }
+}
+
+// isLegal() against membership in getLegalMoves() for every from/to pair
+// (and promotion piece) of the side to move, and the move counters against
+// the list size, two plies deep from each perft position.
+static void testLegality() {
+    int mismatches=0;
+    for (const PerftCase& c:PERFT_CASES) {
+        ChessGame game;
+        if (!game.loadFen(c.fen)) { check(false,"perft FEN accepted"); continue; }
+        forEachNode(game,2,[&](ChessGame& g) {
+            vector<Move> legal=g.getLegalMoves(g.sideToMove());
+            vector<uint16_t> packed;
+            for (auto& m:legal) packed.push_back(packMove(m));
+            if (g.countLegalMoves()!=(int)legal.size() || g.hasLegalMove()==legal.empty()) mismatches++;
+            for (int from=0;from<64;from++) {
+                Piece p=g.pieceAt(from/8,from%8);
+                if (p.color!=g.sideToMove()) continue;
+                for (int to=0;to<64;to++)
+                    for (int promo=EMPTY;promo<=(p.type==PAWN?QUEEN:EMPTY);promo++) {
+                        if (promo==PAWN) continue;
+                        Move m;
+                        m.fromRow=from/8; m.fromCol=from%8;
+                        m.toRow=to/8;     m.toCol=to%8;
+                        m.promotion=PieceType(promo);
+                        g.fillMoveFlags(m);
+                        bool listed=find(packed.begin(),packed.end(),packMove(m))!=packed.end();
+                        if (g.isLegal(m)!=listed) mismatches++;
+                    }
+            }
+        });
+    }
+    check(mismatches==0,"isLegal and countLegalMoves agree with getLegalMoves");
+}
+
+// givesCheck() against making the move and testing the other king, for
+// every legal move two plies deep from each perft position.
+static void testGivesCheck() {
+    int mismatches=0;
+    for (const PerftCase& c:PERFT_CASES) {
+        ChessGame game;
+        if (!game.loadFen(c.fen)) continue;
+        forEachNode(game,2,[&](ChessGame& g) {
+            ChessGame::CheckInfo ci=g.checkInfo();
+            for (auto& m:g.getLegalMoves(g.sideToMove())) {
+                bool predicted=g.givesCheck(m,ci);
+                ChessGame::UndoInfo u;
+                g.applyMove(m,u);
+                bool actual=g.isInCheck(g.sideToMove());
+                g.unapplyMove(m,u);
+                if (predicted!=actual || g.givesCheck(m)!=actual) mismatches++;
+            }
+        });
+    }
+    check(mismatches==0,"givesCheck agrees with make + isInCheck");
+}
+
+// ---------- variation tree ----------
+// Scripted MOVE/UNDO/REDO/GOTO over two branches; after each step the game
+// must match a replay of the expected line from the root.
+static void testVariationTree() {
+    ChessGame game;
+    vector<string> line;    // expected moves from the root to the cursor
+    auto play=[&](const string& t) {
+        Move u,a;
+        check(game.parseMove(t,u) && game.findLegalMove(u,a),"tree move legal");
+        game.makeMove(a);
+        line.push_back(t);
+    };
+    auto matches=[&](const char* what) {
+        ChessGame replay;
+        for (auto& t:line) {
+            Move u,a;
+            if (!replay.parseMove(t,u) || !replay.findLegalMove(u,a)) { check(false,what); return; }
+            replay.makeMove(a);
+        }
+        check(game.currentPly()==(int)line.size() && game.positionHash()==replay.positionHash() &&
+              game.halfMoves()==replay.halfMoves(),what);
+    };
+    auto children=[](const ChessGame::VariationNode* v) {
+        int n=0;
+        for (v=v->firstChild;v;v=v->nextSibling) n++;
+        return n;
+    };
+
+    // ten plies, so the line crosses the ply-8 checkpoint
+    const vector<string> main={"e2e4","e7e5","g1f3","b8c6","f1b5","a7a6","b5a4","g8f6","e1g1","f8e7"};
+    for (auto& t:main) play(t);
+    matches("main line");
+
+    for (int i=0;i<3;i++) { game.undo(); line.pop_back(); }
+    matches("undo to ply 7");
+    play("b7b5");                                   // sibling of g8f6
+    matches("side line");
+    game.undo(); line.pop_back();
+    game.redo(); line.push_back("b7b5");
+    matches("redo follows the side line played last");
+
+    game.undo(); line.pop_back();
+    check(children(game.currentNode())==2,"two branches at ply 7");
+    play("g8f6");                                   // re-enters the old child
+    check(children(game.currentNode()->parent)==2,"re-entering adds no branch");
+    game.redo(); line.push_back("e1g1");
+    game.redo(); line.push_back("f8e7");
+    matches("redo replays the re-entered line");
+    game.redo();
+    matches("redo at the end of the line does nothing");
+
+    check(game.goTo(2),"goTo 2");
+    line.resize(2);
+    matches("goTo back over the checkpoint");
+    check(game.goTo(10),"goTo 10");
+    line=main;
+    matches("goTo forward over the checkpoint");
+    check(game.goTo(1) && game.goTo(9),"goTo 1 then 9");
+    line.resize(9);
+    matches("goTo 9 from the checkpoint at 8");
+    check(!game.goTo(11) && game.currentPly()==9,"goTo past the line fails in place");
+
+    check(game.goTo(7),"goTo 7");
+    line.resize(7);
+    play("b7b5");
+    check(!game.goTo(10) && game.goTo(0),"side line is 8 plies long");
+    line.clear();
+    matches("goTo root");
+    check(game.goTo(8),"goTo 8 along the side line");
+    line={"e2e4","e7e5","g1f3","b8c6","f1b5","a7a6","b5a4","b7b5"};
+    matches("side line checkpoint");
+}
+
+// ---------- packed records ----------
+// PackedPosition and Checkpoint share packPlacement(); a record turned back
+// into a FEN must give the same position.
+static void testPackedRoundTrip() {
+    static const char* const fens[]={
+        START_FEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    };
+    for (const char* fen:fens) {
+        ChessGame a, b;
+        check(a.loadFen(fen),"round-trip FEN accepted");
+        string back=packedToFen(packPosition(a,0,0));
+        check(b.loadFen(back) && a.positionHash()==b.positionHash(),"packed record round trip");
+    }
+}
+
+// ---------- explorer key ----------
+// The explorer indexes by repetitionKey(): transpositions through a double
+// push must meet, while positionHash() still tells them apart.
+static void testExplorerKey() {
+    auto play=[](ChessGame& g,const vector<const char*>& line) {
+        for (const char* t:line) {
+            Move u,a;
+            check(g.parseMove(t,u) && g.findLegalMove(u,a),"explorer line move legal");
+            g.makeMove(a);
+        }
+    };
+    ChessGame a, b;
+    play(a,{"d2d4","g8f6","c2c4"});
+    play(b,{"c2c4","g8f6","d2d4"});
+    check(a.repetitionKey()==b.repetitionKey(),"transposition shares the explorer key");
+    check(a.positionHash()!=b.positionHash(),"positionHash keeps the en passant file");
+}
+
+// ---------- latency percentiles ----------
+// Nearest rank: with few samples p99 is the largest one, never a lower one.
+static void testLatencyPercentiles() {
+    LatencyHistogram h;
+    h.record(1000);
+    h.record(1900);
+    h.record(9900);
+    check(h.percentile(0.99)==9900,"p99 of 3 samples is the maximum");
+    check(h.percentile(0.5)>=1800 && h.percentile(0.5)<=2000,"p50 of 3 samples is the middle one");
+    check(h.percentile(0.2)<=1100,"p20 of 3 samples is the smallest");
+
+    h.reset();
+    for (uint64_t v=1;v<=100;v++) h.record(v*1000);
+    uint64_t p90=h.percentile(0.9);
+    check(p90>=90000*7/8 && p90<=90000*9/8,"p90 of 100 samples is near the 90th");
+    check(h.percentile(0.07)>=7000*7/8 && h.percentile(0.07)<=7000*9/8,"p7 of 100 samples is near the 7th");
+    check(LatencyHistogram().percentile(0.99)==0,"empty histogram");
+
+    // the sorted-sample helper behind bench, microbench and perf_gate
+    vector<int> v={1,2,3,4,5,6,7,8,9,10};
+    check(sortedPercentile(v,0.5)==5 && sortedPercentile(v,0.9)==9,"p50/p90 of 10 sorted samples");
+    check(sortedPercentile(v,0.99)==10 && sortedPercentile(v,0.01)==1,"p99/p1 of 10 sorted samples");
+    check(sortedPercentile(vector<int>{7},0.5)==7,"single sample");
+}
+
+int main() {
+    testFenLimits();
+    testLegality();
+    testGivesCheck();
+    testVariationTree();
+    testPackedRoundTrip();
+    testExplorerKey();
+    testLatencyPercentiles();
+    cout<<(failures?"FAILED":"ok")<<" ("<<failures<<" failures)\n";
+    return failures;
+}
@@ -0,0 +1,141 @@
+// Builds the opening explorer index queried by the engine's EXPLORE command.
+//
+//   explorer_build <archive.txt> <index.bin> [--max-ply N]
+//
+// Archive format: one game per line, moves in the same UCI notation the GUI
+// sends ("e2e4 e7e5 g1f3 ..."). A result token (1-0, 0-1, 1/2-1/2, *) may
+// appear anywhere on the line. Empty lines and lines starting with '#' or '['
+// are skipped. Game IDs are 1-based in archive order.
+#include "chess_engine.h"
+#include "chess_explorer.h"
+
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <unordered_map>
+
+struct MoveStats {
+    uint32_t games=0, whiteWins=0, draws=0, blackWins=0;
+};
+
+struct PositionStats {
+    map<uint16_t,MoveStats> moves;
+    vector<uint32_t> games;
+};
+
+int main(int argc, char** argv) {
+    if (argc<3) {
+        cerr<<"usage: explorer_build <archive.txt> <index.bin> [--max-ply N]\n";
+        return 1;
+    }
+    int maxPly=40;
+    for (int i=3;i<argc;i++) {
+        string arg=argv[i];
+        if (arg=="--max-ply" && i+1<argc) maxPly=atoi(argv[++i]);
+    }
+
+    ifstream in(argv[1]);
+    if (!in) {
+        cerr<<"cannot open archive "<<argv[1]<<"\n";
+        return 1;
+    }
+
+    unordered_map<uint64_t,PositionStats> table;
+    uint32_t gameId=0, badGames=0;
+    string line;
+    while (getline(in,line)) {
+        if (!line.empty() && line.back()=='\r') line.pop_back();
+        if (line.empty() || line[0]=='#' || line[0]=='[') continue;
+
+        istringstream ss(line);
+        vector<string> moves;
+        int result=-1;      // 0 black wins, 1 draw, 2 white wins, -1 unknown
+        string tok;
+        while (ss>>tok) {
+            if (tok=="1-0") result=2;
+            else if (tok=="0-1") result=0;
+            else if (tok=="1/2-1/2") result=1;
+            else if (tok=="*") result=-1;
+            else moves.push_back(tok);
+        }
+        if (moves.empty()) continue;
+        ++gameId;
+
+        ChessGame game;
+        for (int ply=0;ply<(int)moves.size() && ply<maxPly;ply++) {
+            Move u,a;
+            if (!game.parseMove(moves[ply],u) || !game.findLegalMove(u,a)) {
+                cerr<<"game "<<gameId<<": illegal move "<<moves[ply]
+                    <<" at ply "<<ply+1<<"\n";
+                badGames++;
+                break;
+            }
+            // repetitionKey() drops an en passant file nobody can use, so
+            // transpositions through a double push share an entry
+            PositionStats& ps=table[game.repetitionKey()];
+            if (ps.games.empty() || ps.games.back()!=gameId)
+                ps.games.push_back(gameId);
+            MoveStats& ms=ps.moves[packMove(a)];
+            ms.games++;
+            if (result==2) ms.whiteWins++;
+            else if (result==1) ms.draws++;
+            else if (result==0) ms.blackWins++;
+            game.makeMove(a);
+        }
+    }
+
+    // Flatten into the sorted on-disk layout.
+    vector<uint64_t> keys;
+    keys.reserve(table.size());
+    for (auto& kv:table) keys.push_back(kv.first);
+    sort(keys.begin(),keys.end());
+
+    vector<ExplorerPosition> positions;
+    vector<ExplorerMove> moveTable;
+    vector<uint32_t> postings;
+    positions.reserve(keys.size());
+    for (uint64_t key:keys) {
+        PositionStats& ps=table[key];
+        ExplorerPosition p;
+        p.key=key;
+        p.firstMove=(uint32_t)moveTable.size();
+        p.moveCount=(uint32_t)ps.moves.size();
+        p.firstPosting=(uint32_t)postings.size();
+        p.postingCount=(uint32_t)ps.games.size();
+        size_t first=moveTable.size();
+        for (auto& mv:ps.moves) {
+            ExplorerMove em;
+            em.move=mv.first; em.reserved=0;
+            em.games=mv.second.games; em.whiteWins=mv.second.whiteWins;
+            em.draws=mv.second.draws; em.blackWins=mv.second.blackWins;
+            moveTable.push_back(em);
+        }
+        stable_sort(moveTable.begin()+first,moveTable.end(),
+            [](const ExplorerMove& a,const ExplorerMove& b){ return a.games>b.games; });
+        postings.insert(postings.end(),ps.games.begin(),ps.games.end());
+        positions.push_back(p);
+    }
+
+    ExplorerHeader h;
+    memcpy(h.magic,EXPLORER_MAGIC,8);
+    h.version=EXPLORER_VERSION;
+    h.reserved=0;
+    h.positionCount=positions.size();
+    h.moveCount=moveTable.size();
+    h.postingCount=postings.size();
+    h.gameCount=gameId;
+
+    ofstream out(argv[2],ios::binary);
+    out.write((const char*)&h,sizeof(h));
+    out.write((const char*)positions.data(),positions.size()*sizeof(ExplorerPosition));
+    out.write((const char*)moveTable.data(),moveTable.size()*sizeof(ExplorerMove));
+    out.write((const char*)postings.data(),postings.size()*sizeof(uint32_t));
+    if (!out) {
+        cerr<<"cannot write index "<<argv[2]<<"\n";
+        return 1;
+    }
+
+    cout<<"games "<<gameId<<" (illegal "<<badGames<<"), positions "<<positions.size()
+        <<", moves "<<moveTable.size()<<", postings "<<postings.size()<<"\n";
+    return 0;
+}
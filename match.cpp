@@ -0,0 +1,478 @@
+// Engine-vs-engine match runner with SPRT early stopping.
+//
+//   match -engine1 <path|internal> [key=value ...] -engine2 <path|internal> [key=value ...]
+//         [-games N] [-concurrency N] [-tc base+inc | -depth N | -nodes N]
+//         [-openings file.epd] [-draw moves:score:afterply] [-resign moves:score]
+//         [-maxply N] [-sprt elo0:elo1:alpha:beta]
+//
+// "internal" plays this build's searcher in-process (options: hash=MB,
+// depth=N, nodes=N); anything else is started as a child process speaking the
+// chessV5_GUI line protocol (POSITION / MOVE / GO, each answered by a state
+// block). Openings are FEN/EPD lines; each is played twice with colours
+// reversed.
+#include "chess_engine.h"
+#include "chess_search.h"
+#include "chess_bench.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// ================= PLAYERS =================
+struct EngineSpec {
+    string path;                    // "internal" or an executable
+    string name;
+    int hashMb=16;
+    SearchLimits limits;            // per-engine override of the match limits
+};
+
+struct GoResult {
+    bool ok;
+    string move;
+    int score;
+};
+
+struct TimeControl {
+    int64_t base=0, increment=0;    // ms; base 0 = no clock
+    SearchLimits limits;            // fixed depth/nodes when there is no clock
+};
+
+class MatchPlayer {
+public:
+    virtual ~MatchPlayer() {}
+    virtual bool newGame(const string& fen)=0;
+    virtual bool playMove(const string& uci)=0;
+    virtual GoResult go(const TimeControl& tc,int64_t wtime,int64_t btime)=0;
+};
+
+class InternalPlayer : public MatchPlayer {
+private:
+    ChessGame game;
+    Searcher searcher;
+    EngineSpec spec;
+
+public:
+    InternalPlayer(const EngineSpec& s) : searcher(game,s.hashMb), spec(s) {}
+
+    bool newGame(const string& fen) override {
+        searcher.clear();
+        return game.loadFen(fen);
+    }
+
+    bool playMove(const string& uci) override {
+        Move u,a;
+        if (!game.parseMove(uci,u) || !game.findLegalMove(u,a)) return false;
+        ChessGame::UndoInfo info;
+        game.applyMove(a,info);
+        return true;
+    }
+
+    GoResult go(const TimeControl& tc,int64_t wtime,int64_t btime) override {
+        SearchLimits lim=tc.limits;
+        if (tc.base>0)
+            lim.movetime=allocateTime(game.sideToMove()==WHITE?wtime:btime,tc.increment,0);
+        if (spec.limits.depth) lim.depth=spec.limits.depth;
+        if (spec.limits.nodes) lim.nodes=spec.limits.nodes;
+        GoResult r;
+        r.ok=game.hasLegalMove();
+        if (!r.ok) return r;
+        SearchInfo info=searcher.search(lim);
+        r.move=game.moveToString(info.best);
+        r.score=info.score;
+        return r;
+    }
+};
+
+#ifndef _WIN32
+class ProcessPlayer : public MatchPlayer {
+private:
+    pid_t pid;
+    FILE* toEngine;
+    FILE* fromEngine;
+    EngineSpec spec;
+
+    bool send(const string& line) {
+        if (!toEngine) return false;
+        fputs((line+"\n").c_str(),toEngine);
+        return fflush(toEngine)==0;
+    }
+
+    // Reads up to and including the STATUS line; collects everything else.
+    bool readState(vector<string>* lines=nullptr) {
+        char buf[512];
+        while (fromEngine && fgets(buf,sizeof(buf),fromEngine)) {
+            string s(buf);
+            while (!s.empty() && (s.back()=='\n' || s.back()=='\r')) s.pop_back();
+            if (s.compare(0,6,"STATUS")==0) return true;
+            if (lines) lines->push_back(s);
+        }
+        return false;
+    }
+
+public:
+    // Engines are started from several worker threads. Every pipe end is
+    // close-on-exec (dup2 clears the flag on the child's stdin/stdout), so an
+    // engine never inherits another engine's pipes and a crash still reaches
+    // EOF. pipe2() is not everywhere, so pipe+fcntl+fork is serialised
+    // instead: no fork can slip in before the flag is set.
+    static bool cloexecPipe(int fds[2]) {
+        if (pipe(fds)!=0) return false;
+        fcntl(fds[0],F_SETFD,FD_CLOEXEC);
+        fcntl(fds[1],F_SETFD,FD_CLOEXEC);
+        return true;
+    }
+
+    ProcessPlayer(const EngineSpec& s) : pid(-1), toEngine(nullptr), fromEngine(nullptr), spec(s) {
+        static mutex spawnLock;
+        int in[2], out[2];
+        {
+            lock_guard<mutex> g(spawnLock);
+            if (!cloexecPipe(in)) return;
+            if (!cloexecPipe(out)) { ::close(in[0]); ::close(in[1]); return; }
+            pid=fork();
+        }
+        if (pid<0) {
+            ::close(in[0]); ::close(in[1]); ::close(out[0]); ::close(out[1]);
+            return;
+        }
+        if (pid==0) {
+            dup2(in[0],0);
+            dup2(out[1],1);
+            ::close(in[0]); ::close(in[1]); ::close(out[0]); ::close(out[1]);
+            execl(spec.path.c_str(),spec.path.c_str(),(char*)nullptr);
+            _exit(127);
+        }
+        ::close(in[0]);
+        ::close(out[1]);
+        toEngine=fdopen(in[1],"w");
+        fromEngine=fdopen(out[0],"r");
+        readState();                // initial board
+    }
+
+    ~ProcessPlayer() override {
+        send("QUIT");
+        if (toEngine) fclose(toEngine);
+        if (fromEngine) fclose(fromEngine);
+        if (pid>0) waitpid(pid,nullptr,0);
+    }
+
+    bool newGame(const string& fen) override {
+        vector<string> lines;
+        if (!send("POSITION "+fen) || !readState(&lines)) return false;
+        for (auto& l:lines) if (l.compare(0,5,"ERROR")==0) return false;
+        return true;
+    }
+
+    bool playMove(const string& uci) override {
+        vector<string> lines;
+        if (!send("MOVE "+uci) || !readState(&lines)) return false;
+        for (auto& l:lines) if (l.compare(0,5,"ERROR")==0) return false;
+        return true;
+    }
+
+    GoResult go(const TimeControl& tc,int64_t wtime,int64_t btime) override {
+        string cmd="GO";
+        if (tc.base>0)
+            cmd+=" wtime "+to_string(wtime)+" btime "+to_string(btime)+
+                 " winc "+to_string(tc.increment)+" binc "+to_string(tc.increment);
+        int depth=spec.limits.depth?spec.limits.depth:tc.limits.depth;
+        uint64_t nodes=spec.limits.nodes?spec.limits.nodes:tc.limits.nodes;
+        if (depth) cmd+=" depth "+to_string(depth);
+        if (nodes) cmd+=" nodes "+to_string(nodes);
+        GoResult r;
+        r.ok=false;
+        vector<string> lines;
+        if (!send(cmd) || !readState(&lines)) return r;
+        for (auto& l:lines) {
+            istringstream ss(l);
+            string tag, key;
+            ss>>tag;
+            if (tag!="BESTMOVE") continue;
+            ss>>r.move;
+            r.score=0;
+            while (ss>>key) if (key=="SCORE") ss>>r.score;
+            r.ok=r.move!="none";
+        }
+        return r;
+    }
+};
+#endif
+
+inline unique_ptr<MatchPlayer> makePlayer(const EngineSpec& spec) {
+    if (spec.path=="internal") return unique_ptr<MatchPlayer>(new InternalPlayer(spec));
+#ifndef _WIN32
+    return unique_ptr<MatchPlayer>(new ProcessPlayer(spec));
+#else
+    cerr<<"external engines are not supported on this platform\n";
+    exit(1);
+#endif
+}
+
+// ================= GAME PLAY =================
+struct Adjudication {
+    int drawMoves=0, drawScore=0, drawAfterPly=80;  // drawMoves 0 = off
+    int resignMoves=0, resignScore=1000;            // resignMoves 0 = off
+    int maxPlies=400;
+};
+
+// Result from engine1's point of view: 1 win, 0 draw, -1 loss. An error is
+// a game that never got a result (an engine failed to set up or lost sync)
+// and is left out of the statistics.
+struct GameOutcome {
+    int result;
+    string reason;
+    bool error;
+};
+
+inline GameOutcome playMatchGame(MatchPlayer* white,MatchPlayer* black,bool engine1White,
+                                 const string& fen,const TimeControl& tc,const Adjudication& adj) {
+    auto outcome=[&](int whiteResult,const string& why) {
+        GameOutcome o;
+        o.result=engine1White?whiteResult:-whiteResult;
+        o.reason=why;
+        o.error=false;
+        return o;
+    };
+    auto failure=[&](const string& why) {
+        GameOutcome o=outcome(0,why);
+        o.error=true;
+        return o;
+    };
+    ChessGame game;
+    game.loadFen(fen);
+    if (!white->newGame(fen) || !black->newGame(fen)) return failure("setup failed");
+
+    int64_t clock[3]={0,tc.base,tc.base};
+    vector<uint64_t> seen(1,game.positionHash());
+    int drawRun=0, resignRun[3]={0,0,0};
+    for (int ply=0;;ply++) {
+        Color us=game.sideToMove();
+        int sign=us==WHITE?1:-1;
+        if (!game.hasLegalMove())
+            return game.isInCheck(us)?outcome(-sign,"checkmate"):outcome(0,"stalemate");
+        if (game.halfMoves()>=100) return outcome(0,"50-move rule");
+        if (count(seen.begin(),seen.end(),seen.back())>=3) return outcome(0,"repetition");
+        if (game.insufficientMaterial()) return outcome(0,"insufficient material");
+        if (ply>=adj.maxPlies) return outcome(0,"max plies");
+
+        MatchPlayer* p=us==WHITE?white:black;
+        auto t0=chrono::steady_clock::now();
+        GoResult r=p->go(tc,clock[WHITE],clock[BLACK]);
+        int64_t spent=chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now()-t0).count();
+        if (!r.ok) return outcome(-sign,"engine failure");
+        if (tc.base>0) {
+            clock[us]-=spent;
+            if (clock[us]<0) return outcome(-sign,"time forfeit");
+            clock[us]+=tc.increment;
+        }
+
+        Move u,a;
+        if (!game.parseMove(r.move,u) || !game.findLegalMove(u,a))
+            return outcome(-sign,"illegal move "+r.move);
+        ChessGame::UndoInfo info;
+        game.applyMove(a,info);
+        seen.push_back(game.positionHash());
+        if (!white->playMove(r.move) || !black->playMove(r.move))
+            return failure("engine desync");
+
+        if (adj.resignMoves) {
+            resignRun[us]=r.score<=-adj.resignScore?resignRun[us]+1:0;
+            if (resignRun[us]>=adj.resignMoves) return outcome(-sign,"resign adjudication");
+        }
+        if (adj.drawMoves && ply>=adj.drawAfterPly) {
+            drawRun=abs(r.score)<=adj.drawScore?drawRun+1:0;
+            if (drawRun>=adj.drawMoves*2) return outcome(0,"draw adjudication");
+        }
+    }
+}
+
+// ================= STATISTICS =================
+struct MatchStats {
+    int wins=0, draws=0, losses=0;
+    int errors=0;       // unscored games
+
+    int games() { return wins+draws+losses; }
+    double score() { return games()?(wins+draws*0.5)/games():0.5; }
+
+    // per-game variance of the score
+    double variance() {
+        double s=score(), n=games();
+        if (!n) return 0;
+        return (wins*(1-s)*(1-s)+draws*(0.5-s)*(0.5-s)+losses*s*s)/n;
+    }
+
+    static double eloToScore(double elo) { return 1/(1+pow(10,-elo/400)); }
+    static double scoreToElo(double s) {
+        s=min(max(s,1e-6),1-1e-6);
+        return -400*log10(1/s-1);
+    }
+
+    double elo() { return scoreToElo(score()); }
+    double eloError() {     // 95% confidence half-width
+        if (!games()) return 0;
+        double se=sqrt(variance()/games());
+        return (scoreToElo(score()+1.96*se)-scoreToElo(score()-1.96*se))/2;
+    }
+
+    // Log-likelihood ratio of elo1 vs elo0 under the normal approximation
+    // to the trinomial (GSPRT).
+    double llr(double elo0,double elo1) {
+        double var=variance();
+        if (games()==0 || var<=0) return 0;
+        double s0=eloToScore(elo0), s1=eloToScore(elo1);
+        return games()*(s1-s0)*(2*score()-s0-s1)/(2*var);
+    }
+};
+
+struct SprtConfig {
+    bool enabled=false;
+    double elo0=0, elo1=5, alpha=0.05, beta=0.05;
+    double lower() { return log(beta/(1-alpha)); }
+    double upper() { return log((1-beta)/alpha); }
+};
+
+// ================= COMMAND LINE =================
+static void usage() {
+    cerr<<"usage: match -engine1 <path|internal> [key=value ...] -engine2 <path|internal> [key=value ...]\n"
+          "             [-games N] [-concurrency N] [-tc base+inc | -depth N | -nodes N]\n"
+          "             [-openings file] [-draw moves:score:afterply] [-resign moves:score]\n"
+          "             [-maxply N] [-sprt elo0:elo1:alpha:beta]\n";
+}
+
+int main(int argc, char** argv) {
+#ifndef _WIN32
+    signal(SIGPIPE,SIG_IGN);
+#endif
+    EngineSpec spec[2];
+    spec[0].name="engine1"; spec[1].name="engine2";
+    int games=100, concurrency=max(1u,thread::hardware_concurrency());
+    TimeControl tc;
+    tc.limits.depth=4;
+    Adjudication adj;
+    SprtConfig sprt;
+    string openingsFile;
+
+    for (int i=1;i<argc;i++) {
+        string a=argv[i];
+        auto next=[&]() { return i+1<argc?string(argv[++i]):string(); };
+        if (a=="-engine1" || a=="-engine2") {
+            EngineSpec& s=spec[a=="-engine1"?0:1];
+            s.path=next();
+            if (s.path!="internal") s.name=s.path;
+            while (i+1<argc && argv[i+1][0]!='-') {
+                string opt=argv[++i];
+                size_t eq=opt.find('=');
+                string key=opt.substr(0,eq), val=eq==string::npos?"":opt.substr(eq+1);
+                if (key=="hash") s.hashMb=atoi(val.c_str());
+                else if (key=="depth") s.limits.depth=atoi(val.c_str());
+                else if (key=="nodes") s.limits.nodes=strtoull(val.c_str(),nullptr,10);
+                else if (key=="name") s.name=val;
+            }
+        }
+        else if (a=="-games") games=atoi(next().c_str());
+        else if (a=="-concurrency") concurrency=atoi(next().c_str());
+        else if (a=="-depth") { tc.limits=SearchLimits(); tc.limits.depth=atoi(next().c_str()); }
+        else if (a=="-nodes") { tc.limits=SearchLimits(); tc.limits.nodes=strtoull(next().c_str(),nullptr,10); }
+        else if (a=="-tc") {
+            string v=next();
+            size_t plus=v.find('+');
+            tc.base=(int64_t)(atof(v.substr(0,plus).c_str())*1000);
+            tc.increment=plus==string::npos?0:(int64_t)(atof(v.substr(plus+1).c_str())*1000);
+            tc.limits=SearchLimits();
+        }
+        else if (a=="-openings") openingsFile=next();
+        else if (a=="-maxply") adj.maxPlies=atoi(next().c_str());
+        else if (a=="-draw") sscanf(next().c_str(),"%d:%d:%d",&adj.drawMoves,&adj.drawScore,&adj.drawAfterPly);
+        else if (a=="-resign") sscanf(next().c_str(),"%d:%d",&adj.resignMoves,&adj.resignScore);
+        else if (a=="-sprt") {
+            sprt.enabled=true;
+            sscanf(next().c_str(),"%lf:%lf:%lf:%lf",&sprt.elo0,&sprt.elo1,&sprt.alpha,&sprt.beta);
+        }
+        else { usage(); return 1; }
+    }
+    if (spec[0].path.empty() || spec[1].path.empty()) { usage(); return 1; }
+
+    vector<string> openings;
+    if (!openingsFile.empty()) {
+        ifstream in(openingsFile);
+        if (!in) { cerr<<"cannot open "<<openingsFile<<"\n"; return 1; }
+        string line;
+        while (getline(in,line)) {
+            EpdPosition e;
+            if (!line.empty() && line[0]!='#' && parseEpdLine(line,e)) openings.push_back(e.fen);
+        }
+    }
+    if (openings.empty()) openings.push_back(START_FEN);
+
+    MatchStats stats;
+    mutex statsLock;
+    atomic<int> next(0);
+    atomic<bool> stop(false);
+    // consecutive unscored games after which the engines are assumed broken
+    const int MAX_ERROR_RUN=3;
+    int errorRun=0;
+    bool aborted=false;
+
+    auto worker=[&]() {
+        unique_ptr<MatchPlayer> p1=makePlayer(spec[0]), p2=makePlayer(spec[1]);
+        int g;
+        while (!stop && (g=next++)<games) {
+            const string& fen=openings[(g/2)%openings.size()];
+            bool engine1White=g%2==0;
+            GameOutcome o=engine1White
+                ?playMatchGame(p1.get(),p2.get(),true,fen,tc,adj)
+                :playMatchGame(p2.get(),p1.get(),false,fen,tc,adj);
+
+            lock_guard<mutex> lock(statsLock);
+            string pairing=engine1White?spec[0].name+" - "+spec[1].name:spec[1].name+" - "+spec[0].name;
+            if (o.error) {
+                stats.errors++;
+                cout<<"game "<<g+1<<" "<<pairing<<": error ("<<o.reason<<"), not scored\n"<<flush;
+                if (++errorRun>=MAX_ERROR_RUN && !aborted) {
+                    aborted=stop=true;
+                    cout<<"aborting: "<<errorRun<<" games in a row without a result\n"<<flush;
+                }
+                continue;
+            }
+            errorRun=0;
+            if (o.result>0) stats.wins++;
+            else if (o.result<0) stats.losses++;
+            else stats.draws++;
+            cout<<"game "<<g+1<<" "<<pairing
+                <<": "<<(o.result>0?"engine1 wins":o.result<0?"engine2 wins":"draw")<<" ("<<o.reason<<")"
+                <<"  score "<<stats.wins<<"-"<<stats.losses<<"-"<<stats.draws
+                <<"  elo "<<fixed<<setprecision(1)<<stats.elo()<<" +/- "<<stats.eloError();
+            if (sprt.enabled) {
+                double llr=stats.llr(sprt.elo0,sprt.elo1);
+                cout<<"  llr "<<setprecision(2)<<llr<<" ["<<sprt.lower()<<", "<<sprt.upper()<<"]";
+                if (llr>=sprt.upper() || llr<=sprt.lower()) stop=true;
+            }
+            cout<<"\n"<<flush;
+        }
+    };
+    vector<thread> pool;
+    for (int t=0;t<max(1,concurrency);t++) pool.emplace_back(worker);
+    for (auto& t:pool) t.join();
+
+    cout<<"\nGames  : "<<stats.games()<<" (W "<<stats.wins<<" / L "<<stats.losses<<" / D "<<stats.draws<<")";
+    if (stats.errors) cout<<", "<<stats.errors<<" unscored";
+    cout<<"\n";
+    cout<<"Score  : "<<fixed<<setprecision(3)<<stats.score()<<"\n";
+    cout<<"Elo    : "<<setprecision(1)<<stats.elo()<<" +/- "<<stats.eloError()<<" (95%)\n";
+    if (sprt.enabled) {
+        double llr=stats.llr(sprt.elo0,sprt.elo1);
+        cout<<"SPRT   : elo0 "<<sprt.elo0<<" elo1 "<<sprt.elo1<<", llr "<<setprecision(2)<<llr<<" -> "
+            <<(llr>=sprt.upper()?"H1 accepted":llr<=sprt.lower()?"H0 accepted":"inconclusive")<<"\n";
+    }
+    return aborted?1:0;
+}
@@ -0,0 +1,172 @@
+// Performance regression gate: runs `bench` and the microbenchmarks several
+// times, compares the medians with a stored baseline and exits non-zero when
+// something got slower by more than its noise allows.
+//
+//   perf_gate [--baseline FILE] [--runs N] [--threshold PCT] [--write-baseline]
+//
+// Exit status: 0 pass, 1 regression (or bench signature change), 2 error.
+//
+// A metric regresses when its median moved the wrong way by more than
+// max(threshold, 3 * relative MAD * 1.4826), the MAD being the larger of the
+// baseline's and this run's, so noisy benchmarks get wider bands.
+#include "chess_microbench.h"
+
+#include <cstdio>
+#include <map>
+
+struct Metric {
+    double median, mad;     // median absolute deviation, same unit
+};
+
+static Metric summarize(vector<double> v) {
+    sort(v.begin(),v.end());
+    Metric m;
+    m.median=sortedPercentile(v,0.5);
+    for (auto& x:v) x=fabs(x-m.median);
+    sort(v.begin(),v.end());
+    m.mad=sortedPercentile(v,0.5);
+    return m;
+}
+
+// ---------- baseline file ----------
+// Minimal reader for the JSON written below: nested objects of numbers,
+// flattened into dotted keys ("micro.getLegalMoves.median").
+class FlatJson {
+private:
+    const string& s;
+    size_t p;
+
+    void skip() { while (p<s.size() && isspace((unsigned char)s[p])) p++; }
+    bool expect(char c) { skip(); if (p<s.size() && s[p]==c) { p++; return true; } return false; }
+
+    bool readString(string& out) {
+        if (!expect('"')) return false;
+        out.clear();
+        while (p<s.size() && s[p]!='"') {
+            if (s[p]=='\\' && p+1<s.size()) p++;
+            out+=s[p++];
+        }
+        return expect('"');
+    }
+
+public:
+    map<string,double> values;
+
+    FlatJson(const string& text) : s(text), p(0) {}
+
+    bool parseObject(const string& prefix) {
+        if (!expect('{')) return false;
+        if (expect('}')) return true;
+        do {
+            string key;
+            if (!readString(key) || !expect(':')) return false;
+            skip();
+            string path=prefix.empty()?key:prefix+"."+key;
+            if (p<s.size() && s[p]=='{') {
+                if (!parseObject(path)) return false;
+            } else {
+                char* end;
+                double v=strtod(s.c_str()+p,&end);
+                if (end==s.c_str()+p) return false;
+                p=end-s.c_str();
+                values[path]=v;
+            }
+        } while (expect(','));
+        return expect('}');
+    }
+};
+
+int main(int argc, char** argv) {
+    string baselinePath="perf_baseline.json";
+    int runs=5;
+    double minThreshold=3;
+    bool write=false;
+    for (int i=1;i<argc;i++) {
+        string a=argv[i];
+        if (a=="--baseline" && i+1<argc) baselinePath=argv[++i];
+        else if (a=="--runs" && i+1<argc) runs=max(1,atoi(argv[++i]));
+        else if (a=="--threshold" && i+1<argc) minThreshold=atof(argv[++i]);
+        else if (a=="--write-baseline") write=true;
+        else {
+            cerr<<"usage: perf_gate [--baseline FILE] [--runs N] [--threshold PCT] [--write-baseline]\n";
+            return 2;
+        }
+    }
+
+    // ---------- measure ----------
+    NullBuffer null;
+    ostream quiet(&null);
+    MicroOptions mopt;
+    mopt.samples=15;
+    vector<double> nps;
+    map<string,vector<double>> micro;
+    uint64_t nodes=0;
+    for (int r=0;r<runs;r++) {
+        BenchResult b=runBench(BENCH_DEPTH,quiet);
+        nodes=b.nodes;
+        nps.push_back(b.elapsed>0?b.nodes*1000.0/b.elapsed:b.nodes);
+        for (auto& m:runMicroBenchmarks(mopt)) micro[m.name].push_back(m.median);
+        cerr<<"run "<<r+1<<"/"<<runs<<"  bench "<<(uint64_t)nps.back()<<" nps\n";
+    }
+    map<string,Metric> current;
+    current["bench.nps"]=summarize(nps);
+    for (auto& m:micro) current["micro."+m.first]=summarize(m.second);
+
+    if (write) {
+        FILE* f=fopen(baselinePath.c_str(),"w");
+        if (!f) { cerr<<"cannot write "<<baselinePath<<"\n"; return 2; }
+        fprintf(f,"{\n  \"kernels\": {\"%s\": 1},\n",kernels().isa);
+        fprintf(f,"  \"bench\": {\"depth\": %d, \"nodes\": %llu, \"nps\": {\"median\": %.1f, \"mad\": %.1f}},\n",
+                BENCH_DEPTH,(unsigned long long)nodes,current["bench.nps"].median,current["bench.nps"].mad);
+        fprintf(f,"  \"micro\": {\n");
+        size_t i=0;
+        for (auto& m:micro) {
+            Metric& c=current["micro."+m.first];
+            fprintf(f,"    \"%s\": {\"median\": %.3f, \"mad\": %.3f}%s\n",
+                    m.first.c_str(),c.median,c.mad,++i<micro.size()?",":"");
+        }
+        fprintf(f,"  }\n}\n");
+        fclose(f);
+        cout<<"baseline written to "<<baselinePath<<"\n";
+        return 0;
+    }
+
+    // ---------- compare ----------
+    ifstream in(baselinePath);
+    if (!in) { cerr<<"cannot open "<<baselinePath<<" (create it with --write-baseline)\n"; return 2; }
+    string text((istreambuf_iterator<char>(in)),istreambuf_iterator<char>());
+    FlatJson json(text);
+    if (!json.parseObject("")) { cerr<<"cannot parse "<<baselinePath<<"\n"; return 2; }
+    map<string,double>& base=json.values;
+
+    bool failed=false;
+    if (base["bench.nodes"]!=(double)nodes) {
+        cout<<"FAIL bench signature "<<nodes<<" != baseline "<<(uint64_t)base["bench.nodes"]
+            <<" (search changed: rewrite the baseline)\n";
+        failed=true;
+    }
+    if (!base.count(string("kernels.")+kernels().isa))
+        cout<<"note: baseline was recorded with different kernels than "<<kernels().isa<<"\n";
+
+    cout<<left<<setw(30)<<"metric"<<right<<setw(14)<<"baseline"<<setw(14)<<"current"
+        <<setw(10)<<"change"<<setw(10)<<"allowed"<<"\n";
+    for (auto& c:current) {
+        const string& key=c.first;
+        if (!base.count(key+".median")) {
+            cout<<left<<setw(30)<<key<<right<<setw(14)<<"-"<<"  (not in baseline)\n";
+            continue;
+        }
+        double b=base[key+".median"], bmad=base[key+".mad"];
+        bool higherIsBetter=key=="bench.nps";
+        double noise=max(b>0?bmad/b:0,c.second.median>0?c.second.mad/c.second.median:0);
+        double allowed=max(minThreshold,3*1.4826*noise*100);
+        double change=b>0?(c.second.median-b)/b*100:0;
+        double worse=higherIsBetter?-change:change;
+        const char* verdict=worse>allowed?"REGRESSION":(-worse>allowed?"improved":"ok");
+        if (worse>allowed) failed=true;
+        cout<<left<<setw(30)<<key<<right<<fixed<<setprecision(1)<<setw(14)<<b<<setw(14)<<c.second.median
+            <<setw(9)<<showpos<<change<<"%"<<noshowpos<<setw(9)<<allowed<<"%  "<<verdict<<"\n";
+    }
+    cout<<(failed?"FAIL\n":"PASS\n");
+    return failed?1:0;
+}
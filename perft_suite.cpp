@@ -0,0 +1,68 @@
+// Perft validation suite: leaf counts of the legal move tree for positions
+// chosen to exercise castling, en passant (pins, discovered checks),
+// promotions and mates against published reference counts.
+//
+//   perft_suite [--filter NAME] [--max-nodes N] [--backend NAME]
+//
+// Counts every position twice, with bulk leaf counting (timed) and with every
+// leaf generated by getLegalMoves(), and prints one line per position with
+// the bulk throughput. Exits non-zero on any mismatch. --backend runs the rules over another board backend (bitboard,
+// mailbox8x8, mailbox10x12; default bitboard). Registered with ctest as
+// `perft_suite`, plus a short run per alternative backend.
+#include "chess_perft.h"
+
+#include <iomanip>
+
+template<class Board>
+static int runSuite(const string& filter,uint64_t maxNodes) {
+    BasicChessGame<Board> game;
+    int run=0, failed=0;
+    uint64_t totalNodes=0;
+    double totalSeconds=0;
+    for (const PerftCase& c:PERFT_CASES) {
+        if (!filter.empty() && string(c.name).find(filter)==string::npos) continue;
+        if (maxNodes && c.nodes>maxNodes) continue;
+        run++;
+        if (!game.loadFen(c.fen)) {
+            cout<<"FAIL "<<c.name<<": bad FEN\n";
+            failed++;
+            continue;
+        }
+        PerftRun r=timePerft(game,c.depth);
+        uint64_t n=r.nodes, generated=game.perft(c.depth,false);
+        double s=r.seconds;
+        totalNodes+=n;
+        totalSeconds+=s;
+        bool ok=n==c.nodes && generated==c.nodes;
+        if (!ok) failed++;
+        cout<<(ok?"ok   ":"FAIL ")<<left<<setw(24)<<c.name<<right<<" d"<<c.depth
+            <<setw(12)<<n;
+        if (generated!=n) cout<<" generated "<<generated;
+        if (!ok) cout<<" expected "<<c.nodes;
+        cout<<fixed<<setprecision(2)<<setw(8)<<s<<" s"<<setw(8)<<(s>0?n/s/1e6:0)<<" Mnps\n";
+    }
+    cout<<Board::name()<<": "<<run-failed<<"/"<<run<<" passed, "<<totalNodes<<" nodes in "<<fixed<<setprecision(2)
+        <<totalSeconds<<" s ("<<(totalSeconds>0?totalNodes/totalSeconds/1e6:0)<<" Mnps)\n";
+    return failed?1:0;
+}
+
+int main(int argc, char** argv) {
+    string filter, backend="bitboard";
+    uint64_t maxNodes=0;        // skip cases above this many leaves (0 = all)
+    for (int i=1;i<argc;i++) {
+        string a=argv[i];
+        if (a=="--filter" && i+1<argc) filter=argv[++i];
+        else if (a=="--max-nodes" && i+1<argc) maxNodes=strtoull(argv[++i],nullptr,10);
+        else if (a=="--backend" && i+1<argc) backend=argv[++i];
+        else {
+            cerr<<"usage: perft_suite [--filter NAME] [--max-nodes N] [--backend NAME]\n";
+            return 2;
+        }
+    }
+
+    if (backend==BitboardBoard::name()) return runSuite<BitboardBoard>(filter,maxNodes);
+    if (backend==Mailbox8x8Board::name()) return runSuite<Mailbox8x8Board>(filter,maxNodes);
+    if (backend==Mailbox10x12Board::name()) return runSuite<Mailbox10x12Board>(filter,maxNodes);
+    cerr<<"unknown backend "<<backend<<"\n";
+    return 2;
+}
@@ -1,6 +1,5 @@
 #!/bin/bash
 
 echo "Setting up chess engine..."
-g++ -o chessV5_GUI chess_engine.cpp -std=c++11
-chmod +x chessV5_GUI
+bash build.sh || exit 1
 echo "Setup complete!"
\ No newline at end of file